@@ -3,6 +3,10 @@
 #include "ViewportWidgetModule.h"
 #include "CustomViewportClient.h"
 #include "CustomPreviewScene.h"
+#include "CustomViewportGroup.h"
+#include "ViewportRenderTargetPool.h"
+#include "ViewportWidgetPostProcessAsset.h"
+#include "ViewportWidgetListEntry.h"
 #include "Widgets/SViewportWidget.h"
 #include "Components/ViewportWidget.h"
 
@@ -23,445 +27,4036 @@
 #include "Components/LineBatchComponent.h"
 #include "EngineUtils.h"
 #include "Slate/SceneViewport.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "CanvasTypes.h"
+#include "RenderUtils.h"
+#include "RHI.h"
+#include "Widgets/SOverlay.h"
+#include "Widgets/Images/SImage.h"
 
 #include "AudioDeviceHandle.h"
 #include "AudioDevice.h"
 #include "Components/SkyLightComponent.h"
 #include "Components/ReflectionCaptureComponent.h"
 #include "GameFramework/GameModeBase.h"
+#include "Misc/CoreDelegates.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Engine/Font.h"
+#include "Misc/ScopeExit.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/SkeletalMesh.h"
+#include "Rendering/SkeletalMeshRenderData.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "Engine/Level.h"
+#include "GameFramework/WorldSettings.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/UObjectHash.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "RenderCommandFence.h"
+#include "ContentStreaming.h"
+#include "Engine/Texture.h"
+#include "PSOPrecache.h"
+#include "Interfaces/Interface_PostProcessVolume.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "Engine/SCS_Node.h"
 
 #define LOCTEXT_NAMESPACE "FInputSequenceToolsModule"
 
+DEFINE_LOG_CATEGORY(LogViewportWidget);
+
+CSV_DEFINE_CATEGORY_MODULE(VIEWPORTWIDGET_API, ViewportWidget, true);
+
+DECLARE_CYCLE_STAT(TEXT("Widget Tick"), STAT_ViewportWidget_Tick, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("World Tick"), STAT_ViewportWidget_WorldTick, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Client Tick"), STAT_ViewportWidget_ClientTick, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Update Capture Contents"), STAT_ViewportWidget_UpdateCaptureContents, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Clear Line Batcher"), STAT_ViewportWidget_ClearLineBatcher, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Draw"), STAT_ViewportWidget_Draw, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Draw Group"), STAT_ViewportWidget_DrawGroup, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Draw Pooled"), STAT_ViewportWidget_DrawPooled, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Calc Scene View"), STAT_ViewportWidget_CalcSceneView, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Add Entries"), STAT_ViewportWidget_AddEntries, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Clean Entries"), STAT_ViewportWidget_CleanEntries, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Retarget Entries"), STAT_ViewportWidget_RetargetEntries, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Entry Swap"), STAT_ViewportWidget_EntrySwap, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Prefetch"), STAT_ViewportWidget_Prefetch, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Housekeeping"), STAT_ViewportWidget_Housekeeping, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Mem Report"), STAT_ViewportWidget_MemReport, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Preview Scene Init Stage"), STAT_ViewportWidget_InitStage, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Preview Scene Teardown"), STAT_ViewportWidget_Teardown, STATGROUP_ViewportWidget);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Widgets"), STAT_ViewportWidget_LiveWidgets, STATGROUP_ViewportWidget);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spawned Actors"), STAT_ViewportWidget_SpawnedActors, STATGROUP_ViewportWidget);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Preview Worlds"), STAT_ViewportWidget_PreviewWorlds, STATGROUP_ViewportWidget);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("PSO Precache Hits"), STAT_ViewportWidget_PSOPrecacheHits, STATGROUP_ViewportWidget);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("PSO Precache Misses"), STAT_ViewportWidget_PSOPrecacheMisses, STATGROUP_ViewportWidget);
+
+/** Measures a scope for stat ViewportWidget, Insights and CSV captures at once */
+#define VIEWPORTWIDGET_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(ViewportWidget_##Name); \
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, Name)
+
 //------------------------------------------------------
-// FCustomPreviewScene
+// FViewportWidgetStats
 //------------------------------------------------------
 
-FCustomPreviewScene::FCustomPreviewScene(FCustomPreviewScene::ConstructionValues CVS)
-	: PreviewWorld(nullptr)
-	, bForceAllUsedMipsResident(CVS.bForceMipsResident)
-{
-	EObjectFlags NewObjectFlags = RF_NoFlags;
-	if (CVS.bTransactional)
-	{
-		NewObjectFlags = RF_Transactional;
-	}
-
-	PreviewWorld = NewObject<UWorld>(GetTransientPackage(), NAME_None, NewObjectFlags);
-	PreviewWorld->WorldType = EWorldType::GamePreview;
+int32 FViewportWidgetStats::NumLiveWidgets = 0;
+int32 FViewportWidgetStats::NumSpawnedActors = 0;
+int32 FViewportWidgetStats::NumPreviewWorlds = 0;
+int32 FViewportWidgetStats::NumPSOPrecacheHits = 0;
+int32 FViewportWidgetStats::NumPSOPrecacheMisses = 0;
 
-	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(PreviewWorld->WorldType);
-	WorldContext.SetCurrentWorld(PreviewWorld);
+void FViewportWidgetStats::AddLiveWidgets(int32 Delta)
+{
+	NumLiveWidgets += Delta;
+	SET_DWORD_STAT(STAT_ViewportWidget_LiveWidgets, NumLiveWidgets);
+}
 
-	PreviewWorld->InitializeNewWorld(UWorld::InitializationValues()
-		.AllowAudioPlayback(CVS.bAllowAudioPlayback)
-		.CreatePhysicsScene(false)
-		.RequiresHitProxies(false) // Only Need hit proxies in an editor scene
-		.CreateNavigation(false)
-		.CreateAISystem(false)
-		.ShouldSimulatePhysics(false)
-		.SetTransactional(CVS.bTransactional)
-		.SetDefaultGameMode(CVS.DefaultGameMode)
-		.ForceUseMovementComponentInNonGameWorld(CVS.bForceUseMovementComponentInNonGameWorld));
+void FViewportWidgetStats::AddSpawnedActors(int32 Delta)
+{
+	NumSpawnedActors += Delta;
+	SET_DWORD_STAT(STAT_ViewportWidget_SpawnedActors, NumSpawnedActors);
+}
 
-	FURL URL = FURL();
-	//URL += TEXT("?SpectatorOnly=1");
-	//URL = FURL(NULL, *EditorEngine->BuildPlayWorldURL(*PIEMapName, Params.bStartInSpectatorMode, ExtraURLOptions), TRAVEL_Absolute);
+void FViewportWidgetStats::AddPreviewWorlds(int32 Delta)
+{
+	NumPreviewWorlds += Delta;
+	SET_DWORD_STAT(STAT_ViewportWidget_PreviewWorlds, NumPreviewWorlds);
+}
 
-	if (CVS.OwningGameInstance && PreviewWorld->WorldType == EWorldType::GamePreview)
+void FViewportWidgetStats::AddPSOPrecacheResult(bool bHit)
+{
+	if (bHit)
 	{
-		PreviewWorld->SetGameInstance(CVS.OwningGameInstance);
-
-		FWorldContext& PreviewWorldContext = GEngine->GetWorldContextFromWorldChecked(PreviewWorld);
-		PreviewWorldContext.OwningGameInstance = CVS.OwningGameInstance;
-		PreviewWorldContext.GameViewport = CVS.OwningGameInstance->GetGameViewportClient();
-		PreviewWorldContext.AddRef(PreviewWorld);
-
-		//PreviewWorldContext.PIEInstance =
-
-		if (CVS.DefaultGameMode)
-		{
-			PreviewWorld->SetGameMode(URL);
-
-			AGameModeBase* Mode = PreviewWorld->GetAuthGameMode<AGameModeBase>();
-			ensure(Mode);
-		}
+		NumPSOPrecacheHits++;
+		SET_DWORD_STAT(STAT_ViewportWidget_PSOPrecacheHits, NumPSOPrecacheHits);
 	}
-
-	PreviewWorld->InitializeActorsForPlay(URL);
-
-	if (CVS.bDefaultLighting)
+	else
 	{
-		LineBatcher = NewObject<ULineBatchComponent>(GetTransientPackage());
-		LineBatcher->bCalculateAccurateBounds = false;
-		AddComponent(LineBatcher, FTransform::Identity);
+		NumPSOPrecacheMisses++;
+		SET_DWORD_STAT(STAT_ViewportWidget_PSOPrecacheMisses, NumPSOPrecacheMisses);
 	}
 }
 
-FCustomPreviewScene::~FCustomPreviewScene()
-{
-	// Stop any audio components playing in this scene
-	if (GEngine)
-	{
-		UWorld* World = GetWorld();
-		if (World)
+//------------------------------------------------------
+// FViewportWidgetTimings
+//------------------------------------------------------
+
+static TAutoConsoleVariable<float> CVarHitchThreshold(
+	TEXT("ViewportWidget.HitchThresholdMs"),
+	50.f,
+	TEXT("Class loads, spawns and world creations of viewport widgets taking longer than this in milliseconds are logged as hitches, 0 disables logging."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFirstDrawThreshold(
+	TEXT("ViewportWidget.FirstDrawThresholdMs"),
+	500.f,
+	TEXT("Viewport widgets taking longer than this in milliseconds from construction or an entry change to their first draw are logged as slow, 0 disables logging.\n")
+	TEXT("First draws span several frames, so they are not counted as hitches."),
+	ECVF_Default);
+
+static FAutoConsoleCommand DumpTimingsCommand(
+	TEXT("ViewportWidget.DumpTimings"),
+	TEXT("Logs histograms of viewport widget class load, spawn, world creation and first draw times.\n")
+	TEXT("Usage: ViewportWidget.DumpTimings [-Reset]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
 		{
-			if (FAudioDeviceHandle AudioDevice = World->GetAudioDevice())
+			FViewportWidgetTimings::Dump(*GLog);
+
+			if (Args.Contains(TEXT("-Reset")))
 			{
-				AudioDevice->Flush(GetWorld(), false);
+				FViewportWidgetTimings::Reset();
 			}
-		}
-	}
+		}));
 
-	// Remove all the attached components
-	for (int32 ComponentIndex = 0; ComponentIndex < Components.Num(); ComponentIndex++)
-	{
-		UActorComponent* Component = Components[ComponentIndex];
+int32 FViewportWidgetTimings::NumHitches = 0;
 
-		if (bForceAllUsedMipsResident)
+FHistogram& FViewportWidgetTimings::GetMutableHistogram(EViewportWidgetTiming Timing)
+{
+	static FHistogram Histograms[(int32)EViewportWidgetTiming::Num];
+	static bool bInitialized = false;
+
+	if (!bInitialized)
+	{
+		for (FHistogram& Histogram : Histograms)
 		{
-			// Remove the mip streaming override on the mesh to be removed
-			UMeshComponent* pMesh = Cast<UMeshComponent>(Component);
-			if (pMesh != NULL)
-			{
-				pMesh->SetTextureForceResidentFlag(false);
-			}
+			Histogram.InitHitchTracking();
 		}
 
-		Component->UnregisterComponent();
+		bInitialized = true;
 	}
 
-	// The world may be released by now.
-	if (PreviewWorld && GEngine)
-	{
-		PreviewWorld->CleanupWorld();
-		GEngine->DestroyWorldContext(GetWorld());
-	}
+	return Histograms[(int32)Timing];
 }
 
-void FCustomPreviewScene::AddComponent(UActorComponent* Component, const FTransform& LocalToWorld, bool bAttachToRoot /*= false*/)
+const FHistogram& FViewportWidgetTimings::GetHistogram(EViewportWidgetTiming Timing)
 {
-	Components.AddUnique(Component);
+	return GetMutableHistogram(Timing);
+}
 
-	USceneComponent* SceneComp = Cast<USceneComponent>(Component);
-	if (SceneComp && SceneComp->GetAttachParent() == NULL)
+const TCHAR* FViewportWidgetTimings::GetTimingName(EViewportWidgetTiming Timing)
+{
+	switch (Timing)
 	{
-		SceneComp->SetRelativeTransform(LocalToWorld);
+	case EViewportWidgetTiming::ClassLoad: return TEXT("ClassLoad");
+	case EViewportWidgetTiming::Spawn: return TEXT("Spawn");
+	case EViewportWidgetTiming::WorldCreation: return TEXT("WorldCreation");
+	case EViewportWidgetTiming::FirstDraw: return TEXT("FirstDraw");
+	default: return TEXT("Unknown");
 	}
+}
+
+void FViewportWidgetTimings::Record(EViewportWidgetTiming Timing, double Ms, const SViewportWidget* Widget, int32 EntryIndex, const UClass* Class)
+{
+	check(IsInGameThread());
 
-	Component->RegisterComponentWithWorld(GetWorld());
+	GetMutableHistogram(Timing).AddMeasurement(Ms);
 
-	if (bForceAllUsedMipsResident)
+	const bool bHitch = Timing != EViewportWidgetTiming::FirstDraw;
+	const float ThresholdMs = bHitch ? CVarHitchThreshold.GetValueOnGameThread() : CVarFirstDrawThreshold.GetValueOnGameThread();
+
+	if (ThresholdMs > 0.f && Ms > ThresholdMs)
 	{
-		// Add a mip streaming override to the new mesh
-		UMeshComponent* pMesh = Cast<UMeshComponent>(Component);
-		if (pMesh != NULL)
-		{
-			pMesh->SetTextureForceResidentFlag(true);
-		}
+		NumHitches += bHitch ? 1 : 0;
+
+		UE_LOG(LogViewportWidget, Warning, TEXT("%s: %s took %.2f ms (threshold %.2f ms), widget #%u, entry %d, class %s"),
+			bHitch ? TEXT("Hitch") : TEXT("Slow"), GetTimingName(Timing), Ms, ThresholdMs, Widget ? Widget->GetWidgetId() : 0, EntryIndex, Class ? *Class->GetName() : TEXT("none"));
+
+		CSV_EVENT(ViewportWidget, TEXT("%s %s %.2f ms"), bHitch ? TEXT("Hitch") : TEXT("Slow"), GetTimingName(Timing), Ms);
 	}
+}
 
+void FViewportWidgetTimings::Reset()
+{
+	for (int32 TimingIndex = 0; TimingIndex < (int32)EViewportWidgetTiming::Num; ++TimingIndex)
 	{
-		UStaticMeshComponent* pStaticMesh = Cast<UStaticMeshComponent>(Component);
-		if (pStaticMesh != nullptr)
-		{
-			pStaticMesh->bEvaluateWorldPositionOffset = true;
-			pStaticMesh->bEvaluateWorldPositionOffsetInRayTracing = true;
-		}
+		GetMutableHistogram((EViewportWidgetTiming)TimingIndex).Reset();
 	}
 
-	GetScene()->UpdateSpeedTreeWind(0.0);
+	NumHitches = 0;
 }
 
-void FCustomPreviewScene::RemoveComponent(UActorComponent* Component)
+void FViewportWidgetTimings::Dump(FOutputDevice& Ar)
 {
-	Component->UnregisterComponent();
-	Components.Remove(Component);
+	Ar.Logf(TEXT("Viewport widget timings, %d hitches:"), NumHitches);
 
-	if (bForceAllUsedMipsResident)
+	for (int32 TimingIndex = 0; TimingIndex < (int32)EViewportWidgetTiming::Num; ++TimingIndex)
 	{
-		// Remove the mip streaming override on the old mesh
-		UMeshComponent* pMesh = Cast<UMeshComponent>(Component);
-		if (pMesh != NULL)
+		const FHistogram& Histogram = GetHistogram((EViewportWidgetTiming)TimingIndex);
+
+		if (Histogram.GetNumMeasurements() == 0)
 		{
-			pMesh->SetTextureForceResidentFlag(false);
+			Ar.Logf(TEXT("  %s: no measurements"), GetTimingName((EViewportWidgetTiming)TimingIndex));
+			continue;
 		}
-	}
-}
 
-void FCustomPreviewScene::AddReferencedObjects(FReferenceCollector& Collector)
-{
-	Collector.AddReferencedObjects(Components);
-	Collector.AddReferencedObject(PreviewWorld);
-}
+		Ar.Logf(TEXT("  %s: %lld measurements, avg %.2f ms, min %.2f ms, max %.2f ms"), GetTimingName((EViewportWidgetTiming)TimingIndex),
+			Histogram.GetNumMeasurements(), Histogram.GetAverageOfAllMeasurements(), Histogram.GetMinOfAllMeasurements(), Histogram.GetMaxOfAllMeasurements());
 
-FString FCustomPreviewScene::GetReferencerName() const
-{
-	return TEXT("FCustomPreviewScene");
+		for (int32 BinIndex = 0; BinIndex < Histogram.GetNumBins(); ++BinIndex)
+		{
+			if (const int64 Count = Histogram.GetBinObservationsCount(BinIndex))
+			{
+				Ar.Logf(TEXT("    %.0f - %.0f ms: %lld"), Histogram.GetBinLowerBound(BinIndex), Histogram.GetBinUpperBound(BinIndex), Count);
+			}
+		}
+	}
 }
 
-void FCustomPreviewScene::UpdateCaptureContents()
-{
-	// This function is called from FAdvancedPreviewScene::Tick, FBlueprintEditor::Tick, and FThumbnailPreviewScene::Tick,
-	// so assume we are inside a Tick function.
-	const bool bInsideTick = true;
-
-	USkyLightComponent::UpdateSkyCaptureContents(PreviewWorld);
-	UReflectionCaptureComponent::UpdateReflectionCaptureContents(PreviewWorld, nullptr, false, false, bInsideTick);
-}
+//------------------------------------------------------
+// FViewportWidgetMemoryUsage
+//------------------------------------------------------
 
-void FCustomPreviewScene::ClearLineBatcher()
+FViewportWidgetMemoryUsage& FViewportWidgetMemoryUsage::operator+=(const FViewportWidgetMemoryUsage& Other)
 {
-	if (LineBatcher != NULL)
-	{
-		LineBatcher->Flush();
-	}
+	UObjectBytes += Other.UObjectBytes;
+	RenderResourceBytes += Other.RenderResourceBytes;
+	ViewStateBytes += Other.ViewStateBytes;
+	RenderTargetBytes += Other.RenderTargetBytes;
+	NumObjects += Other.NumObjects;
+
+	return *this;
 }
 
 //------------------------------------------------------
-// SViewportWidget
+// FCustomPreviewScene
 //------------------------------------------------------
 
-bool IsNotEqual(const TArray<FViewportWidgetEntry>& A, const TArray<FViewportWidgetEntry>& B)
+static TAutoConsoleVariable<float> CVarInitBudget(
+	TEXT("ViewportWidget.InitBudgetMs"),
+	4.f,
+	TEXT("Milliseconds per frame all preview scenes with staged initialization may spend on initialization stages."),
+	ECVF_Default);
+
+namespace CustomPreviewSceneInit_NM
 {
-	if (A.Num() != B.Num())
-	{
-		return true;
-	}
+	/** Frame the budget was last spent in and how much of it */
+	uint64 BudgetFrame = MAX_uint64;
+	double BudgetSpentSeconds = 0.0;
+}
 
-	for (size_t i = 0; i < A.Num(); i++)
+FCustomPreviewScene::FCustomPreviewScene(FCustomPreviewScene::ConstructionValues CVS)
+	: InitValues(CVS)
+	, InitStage(EInitStage::CreateWorld)
+	, TeardownStage(ETeardownStage::UnregisterComponents)
+	, TeardownActorIndex(0)
+	, PreviewWorld(nullptr)
+	, bTransactional(CVS.bTransactional)
+	, bCreateGCCluster(CVS.bCreateGCCluster)
+	, bForceAllUsedMipsResident(CVS.bForceMipsResident)
+{
+	if (!CVS.bStagedInitialization)
 	{
-		if ((A[i].ActorClassPtr != B[i].ActorClassPtr) || (GetTypeHash(A[i].SpawnTransform) != GetTypeHash(B[i].SpawnTransform)))
+		while (!IsReady())
 		{
-			return true;
+			RunInitStage();
 		}
 	}
-
-	return false;
 }
 
-SViewportWidget::SViewportWidget() :LastTickTime(0), PreviewScene(MakeShareable(new FCustomPreviewScene(FCustomPreviewScene::ConstructionValues().SetForceMipsResident(false)))) {}
-
-SViewportWidget::~SViewportWidget()
+bool FCustomPreviewScene::AdvanceInitialization()
 {
-	// Close viewport
-	if (Client.IsValid())
+	using namespace CustomPreviewSceneInit_NM;
+
+	if (BudgetFrame != GFrameCounter)
 	{
-		Client->Viewport = NULL;
+		BudgetFrame = GFrameCounter;
+		BudgetSpentSeconds = 0.0;
 	}
 
-	// Release our reference to the viewport client
-	Client.Reset();
-
-	check(SceneViewport.IsUnique());
-}
-
-void SViewportWidget::Construct(const FArguments& InArgs)
-{
-	ChildSlot
-		[
-			SAssignNew(ViewportWidget, SViewport)
-				.EnableGammaCorrection(false) // Scene rendering handles this
-				.ViewportSize(InArgs._ViewportSize)
-		];
-
-	Client = MakeViewportClient();
+	const double BudgetSeconds = CVarInitBudget.GetValueOnGameThread() / 1000.0;
+	bool bFirstStageInFrame = BudgetSpentSeconds == 0.0;
 
-	if (!Client->VisibilityDelegate.IsBound())
+	while (!IsReady() && (bFirstStageInFrame || BudgetSpentSeconds < BudgetSeconds))
 	{
-		Client->VisibilityDelegate.BindSP(this, &SViewportWidget::IsVisible);
-	}
+		const double StageStartTime = FPlatformTime::Seconds();
 
-	SceneViewport = MakeShareable(new FSceneViewport(Client.Get(), ViewportWidget));
-	Client->Viewport = SceneViewport.Get();
-	ViewportWidget->SetViewportInterface(SceneViewport.ToSharedRef());
+		RunInitStage();
 
-	SetViewTransform(InArgs._ViewTransform.Get(FTransform::Identity));
+		// Never zero, so the next scene this frame sees the budget as started
+		BudgetSpentSeconds += FMath::Max(FPlatformTime::Seconds() - StageStartTime, UE_SMALL_NUMBER);
+		bFirstStageInFrame = false;
+	}
 
-	SetEntries(const_cast<TArray<FViewportWidgetEntry>&>(InArgs._Entries.Get()));
+	return IsReady();
 }
 
-void SViewportWidget::SetViewTransform(const FTransform& viewTransform)
+void FCustomPreviewScene::RunInitStage()
 {
-	if (!ViewTransform.IsSet() || GetTypeHash(ViewTransform.Get()) != GetTypeHash(viewTransform))
-	{
-		ViewTransform = viewTransform;
+	VIEWPORTWIDGET_SCOPE(InitStage);
 
-		Client->SetViewLocation(viewTransform.GetLocation());
-		Client->SetViewRotation(viewTransform.Rotator());
-	}
-}
+	const ConstructionValues& CVS = InitValues;
 
-void SViewportWidget::SetEntries(TArray<FViewportWidgetEntry>& entries)
-{
-	if (!Entries.IsSet() || IsNotEqual(Entries.Get(), entries))
+	switch (InitStage)
 	{
-		CleanEntries();
-		Entries = entries;
-		AddEntries();
-	}
-}
+	case EInitStage::CreateWorld:
+	{
+		EObjectFlags NewObjectFlags = RF_NoFlags;
+		if (CVS.bTransactional)
+		{
+			NewObjectFlags = RF_Transactional;
+		}
 
-void SViewportWidget::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
-{
-	LastTickTime = FPlatformTime::Seconds();
+		PreviewWorld = NewObject<UWorld>(GetTransientPackage(), NAME_None, NewObjectFlags);
+		PreviewWorld->WorldType = EWorldType::GamePreview;
 
-	if (PreviewScene.IsValid())
+		FViewportWidgetStats::AddPreviewWorlds(1);
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(PreviewWorld->WorldType);
+		WorldContext.SetCurrentWorld(PreviewWorld);
+
+		InitStage = EInitStage::InitializeWorld;
+		break;
+	}
+	case EInitStage::InitializeWorld:
 	{
-		PreviewScene->UpdateCaptureContents();
-		PreviewScene->ClearLineBatcher();
+		PreviewWorld->InitializeNewWorld(UWorld::InitializationValues()
+			.AllowAudioPlayback(CVS.bAllowAudioPlayback)
+			.CreatePhysicsScene(false)
+			.RequiresHitProxies(false) // Only Need hit proxies in an editor scene
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.CreateFXSystem(CVS.bCreateFXSystem)
+			.ShouldSimulatePhysics(false)
+			.SetTransactional(CVS.bTransactional)
+			.SetDefaultGameMode(CVS.DefaultGameMode)
+			.ForceUseMovementComponentInNonGameWorld(CVS.bForceUseMovementComponentInNonGameWorld));
+
+		InitStage = EInitStage::InitializeActorsForPlay;
+		break;
 	}
-
-	if (Client.IsValid())
+	case EInitStage::InitializeActorsForPlay:
 	{
-		Client->GetWorld()->Tick(ELevelTick::LEVELTICK_All, InDeltaTime);
+		FURL URL = FURL();
+		//URL += TEXT("?SpectatorOnly=1");
+		//URL = FURL(NULL, *EditorEngine->BuildPlayWorldURL(*PIEMapName, Params.bStartInSpectatorMode, ExtraURLOptions), TRAVEL_Absolute);
 
+		if (CVS.OwningGameInstance && PreviewWorld->WorldType == EWorldType::GamePreview)
 		{
-			FScopedConditionalWorldSwitcher WorldSwitcher(Client->GetWorld());
+			PreviewWorld->SetGameInstance(CVS.OwningGameInstance);
 
-			Client->Tick(InDeltaTime);
-		}
+			FWorldContext& PreviewWorldContext = GEngine->GetWorldContextFromWorldChecked(PreviewWorld);
+			PreviewWorldContext.OwningGameInstance = CVS.OwningGameInstance;
+			PreviewWorldContext.GameViewport = CVS.OwningGameInstance->GetGameViewportClient();
+			PreviewWorldContext.AddRef(PreviewWorld);
 
-		Client->Viewport->Draw();
-	}
-}
+			//PreviewWorldContext.PIEInstance =
 
-bool SViewportWidget::IsVisible() const
-{
-#if WITH_DUMPGPU
-	extern ENGINE_API uint32 GDumpGPU_FrameNumber;
-#endif
+			if (CVS.DefaultGameMode)
+			{
+				PreviewWorld->SetGameMode(URL);
 
-	const float VisibilityTimeThreshold = .25f;
-	// The viewport is visible if we don't have a parent layout (likely a floating window) or this viewport is visible in the parent layout.
-	// Also, always render the viewport if DumpGPU is active, regardless of tick time threshold -- otherwise these don't show up due to lag
-	// caused by the GPU dump being triggered.
-	return
-		ViewportWidget.IsValid() &&
-		LastTickTime == 0.0 ||	// Never been ticked
-		FPlatformTime::Seconds() - LastTickTime <= VisibilityTimeThreshold	// Ticked recently
-#if WITH_DUMPGPU
-		|| GDumpGPU_FrameNumber == GFrameNumber	// GPU dump in progress
-#endif		
-		;
-}
+				AGameModeBase* Mode = PreviewWorld->GetAuthGameMode<AGameModeBase>();
+				ensure(Mode);
+			}
+		}
 
-TWeakObjectPtr<AActor> SViewportWidget::GetSpawnedActor(const int32 entryIndex) const
-{
-	if (Entries.IsSet())
+		PreviewWorld->InitializeActorsForPlay(URL);
+
+		InitStage = EInitStage::CreateLineBatcher;
+		break;
+	}
+	case EInitStage::CreateLineBatcher:
 	{
-		if (Entries.Get().IsValidIndex(entryIndex))
+		if (CVS.bDefaultLighting && CVS.bCreateLineBatcher)
 		{
-			return Entries.Get()[entryIndex].ActorObjectPtr;
+			LineBatcher = NewObject<ULineBatchComponent>(GetTransientPackage());
+			LineBatcher->bCalculateAccurateBounds = false;
+			AddComponent(LineBatcher, FTransform::Identity);
 		}
-	}
 
-	return TWeakObjectPtr<AActor>();
+		InitValues.OwningGameInstance = nullptr;
+		InitStage = EInitStage::Ready;
+		break;
+	}
+	default:
+		break;
+	}
 }
 
-TSharedRef<FCustomViewportClient> SViewportWidget::MakeViewportClient()
+FCustomPreviewScene::~FCustomPreviewScene()
 {
-	TSharedPtr<FCustomViewportClient> client = MakeShareable(new FCustomViewportClient(PreviewScene.Get(), SharedThis(this)));
+	DissolveGCCluster();
 
-	client->SetRealtime(true);
-	client->VisibilityDelegate.BindSP(this, &SViewportWidget::IsVisible);
+	FlushAudio();
 
-	return client.ToSharedRef();
+	// Whatever a deferred teardown didn't get to yet
+	while (TeardownStage != ETeardownStage::Done)
+	{
+		RunTeardownStep();
+	}
+
+	if (PreviewWorld)
+	{
+		FViewportWidgetStats::AddPreviewWorlds(-1);
+	}
 }
 
-void SViewportWidget::CleanEntries()
+void FCustomPreviewScene::FlushAudio()
 {
-	if (UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr)
+	// Stop any audio components playing in this scene
+	if (GEngine)
 	{
-		if (Entries.IsSet())
+		UWorld* World = GetWorld();
+		if (World)
 		{
-			for (FViewportWidgetEntry& ViewportWidgetEntry : const_cast<TArray<FViewportWidgetEntry>&>(Entries.Get()))
+			if (FAudioDeviceHandle AudioDevice = World->GetAudioDevice())
 			{
-				if (AActor* actor = ViewportWidgetEntry.ActorObjectPtr.Get())
-				{
-					world->DestroyActor(actor);
-				}
-
-				ViewportWidgetEntry.ActorObjectPtr.Reset();
+				AudioDevice->Flush(GetWorld(), false);
 			}
 		}
 	}
 }
 
-void SViewportWidget::AddEntries()
+void FCustomPreviewScene::RemoveFromRenderingAndStreaming()
 {
-	if (UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr)
+	if (!PreviewWorld || !PreviewWorld->PersistentLevel)
 	{
-		if (Entries.IsSet())
+		return;
+	}
+
+	// Unregistering later finds the proxies gone and the primitives detached already
+	auto RemovePrimitive = [this](UActorComponent* Component)
 		{
-			for (FViewportWidgetEntry& ViewportWidgetEntry : const_cast<TArray<FViewportWidgetEntry>&>(Entries.Get()))
+			UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component);
+
+			if (Primitive && Primitive->IsRegistered())
+			{
+				IStreamingManager::Get().NotifyPrimitiveDetached(Primitive);
+
+				if (PreviewWorld->Scene)
+				{
+					PreviewWorld->Scene->RemovePrimitive(Primitive);
+				}
+			}
+		};
+
+	for (UActorComponent* Component : Components)
+	{
+		RemovePrimitive(Component);
+	}
+
+	for (AActor* Actor : PreviewWorld->PersistentLevel->Actors)
+	{
+		if (Actor)
+		{
+			Actor->ForEachComponent(false, RemovePrimitive);
+		}
+	}
+}
+
+void FCustomPreviewScene::RunTeardownStep()
+{
+	switch (TeardownStage)
+	{
+	case ETeardownStage::UnregisterComponents:
+	{
+		// Remove the attached components one at a time
+		if (Components.Num() > 0)
+		{
+			UActorComponent* Component = Components.Pop(false);
+
+			if (bForceAllUsedMipsResident)
 			{
-				if (TSubclassOf<AActor> actorClass = ViewportWidgetEntry.ActorClassPtr.LoadSynchronous())
+				// Remove the mip streaming override on the mesh to be removed
+				UMeshComponent* pMesh = Cast<UMeshComponent>(Component);
+				if (pMesh != NULL)
 				{
-					FActorSpawnParameters SpawnInfo;
-					SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-					SpawnInfo.bNoFail = true;
-					SpawnInfo.ObjectFlags = RF_Transient | RF_Transactional;
+					pMesh->SetTextureForceResidentFlag(false);
+				}
+			}
+
+			Component->UnregisterComponent();
+		}
+		else
+		{
+			TeardownStage = ETeardownStage::UnregisterActors;
+		}
+		break;
+	}
+	case ETeardownStage::UnregisterActors:
+	{
+		// CleanupWorld would unregister them all at once
+		ULevel* PersistentLevel = PreviewWorld ? PreviewWorld->PersistentLevel.Get() : nullptr;
+
+		if (PersistentLevel && TeardownActorIndex < PersistentLevel->Actors.Num())
+		{
+			if (AActor* Actor = PersistentLevel->Actors[TeardownActorIndex++])
+			{
+				Actor->UnregisterAllComponents();
+			}
+		}
+		else
+		{
+			TeardownStage = ETeardownStage::CleanupWorld;
+		}
+		break;
+	}
+	case ETeardownStage::CleanupWorld:
+	{
+		// The world may be released by now.
+		if (PreviewWorld && GEngine)
+		{
+			// A staged initialization may have been interrupted before the world was initialized
+			if (InitStage > EInitStage::InitializeWorld)
+			{
+				PreviewWorld->CleanupWorld();
+			}
+
+			GEngine->DestroyWorldContext(PreviewWorld);
+		}
+
+		TeardownStage = ETeardownStage::Done;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static TAutoConsoleVariable<int32> CVarDeferredTeardown(
+	TEXT("ViewportWidget.DeferredTeardown"),
+	1,
+	TEXT("1 spreads the teardown of released preview scenes over later frames, 0 tears them down right away."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTeardownBudget(
+	TEXT("ViewportWidget.TeardownBudgetMs"),
+	2.f,
+	TEXT("Milliseconds per frame spent tearing down released preview scenes, at least one step runs every frame."),
+	ECVF_Default);
+
+namespace CustomPreviewSceneTeardown_NM
+{
+	/** Released scenes, oldest first */
+	TArray<FCustomPreviewScene*> Queue;
+}
+
+void FCustomPreviewScene::DeferredDelete(FCustomPreviewScene* PreviewScene)
+{
+	using namespace CustomPreviewSceneTeardown_NM;
+
+	if (!PreviewScene)
+	{
+		return;
+	}
+
+	if (CVarDeferredTeardown.GetValueOnAnyThread() == 0 || !IsInGameThread() || IsEngineExitRequested())
+	{
+		delete PreviewScene;
+		return;
+	}
+
+	// Nothing draws or ticks the scene anymore, but sounds would still be heard and primitives rendered and streamed
+	PreviewScene->DissolveGCCluster();
+	PreviewScene->FlushAudio();
+	PreviewScene->RemoveFromRenderingAndStreaming();
+
+	Queue.Add(PreviewScene);
+}
+
+void FCustomPreviewScene::TickTeardownQueue()
+{
+	using namespace CustomPreviewSceneTeardown_NM;
+
+	if (Queue.Num() == 0)
+	{
+		return;
+	}
+
+	VIEWPORTWIDGET_SCOPE(Teardown);
+
+	const double EndTime = FPlatformTime::Seconds() + CVarTeardownBudget.GetValueOnGameThread() / 1000.0;
+
+	do
+	{
+		FCustomPreviewScene* PreviewScene = Queue[0];
+
+		if (PreviewScene->TeardownStage != ETeardownStage::Done)
+		{
+			PreviewScene->RunTeardownStep();
+		}
+		else
+		{
+			Queue.RemoveAt(0, 1, false);
+			delete PreviewScene;
+		}
+	} while (Queue.Num() > 0 && FPlatformTime::Seconds() < EndTime);
+}
+
+void FCustomPreviewScene::FlushTeardownQueue()
+{
+	using namespace CustomPreviewSceneTeardown_NM;
+
+	TArray<FCustomPreviewScene*> PreviewScenes = MoveTemp(Queue);
+
+	for (FCustomPreviewScene* PreviewScene : PreviewScenes)
+	{
+		delete PreviewScene;
+	}
+}
+
+int32 FCustomPreviewScene::GetNumQueuedTeardowns()
+{
+	return CustomPreviewSceneTeardown_NM::Queue.Num();
+}
+
+static TAutoConsoleVariable<int32> CVarActorPoolSize(
+	TEXT("ViewportWidget.ActorPoolSize"),
+	16,
+	TEXT("Hidden actors each preview scene keeps per class for reuse by retargeted entries, 0 disables pooling."),
+	ECVF_Default);
+
+bool FCustomPreviewScene::ReleaseActorToPool(AActor* Actor)
+{
+	if (!IsValid(Actor) || Actor->GetWorld() != PreviewWorld)
+	{
+		return false;
+	}
+
+	TArray<AActor*>& PooledActors = ActorPool.FindOrAdd(Actor->GetClass());
+
+	if (PooledActors.Num() >= CVarActorPoolSize.GetValueOnGameThread())
+	{
+		return false;
+	}
+
+	FPooledActorState& State = PooledActorStates.Add(Actor);
+	State.bCollisionEnabled = Actor->GetActorEnableCollision();
+	State.bTickEnabled = Actor->IsActorTickEnabled();
 
-					AActor* actor = world->SpawnActor(actorClass, &ViewportWidgetEntry.SpawnTransform, SpawnInfo);
+	SetActorHiddenInPreview(Actor, true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
 
-					ViewportWidgetEntry.ActorObjectPtr = actor;
+	Actor->ForEachComponent(false, [&State](UActorComponent* Component)
+		{
+			if (Component->IsComponentTickEnabled())
+			{
+				State.TickingComponents.Add(Component);
+				Component->SetComponentTickEnabled(false);
+			}
+		});
+
+	PooledActors.Add(Actor);
+
+	return true;
+}
+
+AActor* FCustomPreviewScene::AcquirePooledActor(UClass* ActorClass, const FTransform& Transform)
+{
+	TArray<AActor*>* PooledActors = ActorPool.Find(ActorClass);
+
+	while (PooledActors && PooledActors->Num() > 0)
+	{
+		AActor* Actor = PooledActors->Pop(false);
+
+		FPooledActorState State;
+		PooledActorStates.RemoveAndCopyValue(Actor, State);
 
-					SetupSpawnedActor(actor, world);
+		if (IsValid(Actor))
+		{
+			Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+			SetActorHiddenInPreview(Actor, false);
+			Actor->SetActorEnableCollision(State.bCollisionEnabled);
+			Actor->SetActorTickEnabled(State.bTickEnabled);
+
+			for (const TWeakObjectPtr<UActorComponent>& Component : State.TickingComponents)
+			{
+				if (Component.IsValid())
+				{
+					Component->SetComponentTickEnabled(true);
 				}
 			}
+
+			return Actor;
+		}
+	}
+
+	return nullptr;
+}
+
+void FCustomPreviewScene::SetActorHiddenInPreview(AActor* Actor, bool bHidden)
+{
+	Actor->SetActorHiddenInGame(bHidden);
+
+#if WITH_EDITOR
+	// Viewport clients draw with editor show flags, which ignore hidden in game
+	Actor->SetIsTemporarilyHiddenInEditor(bHidden);
+#endif
+}
+
+int32 FCustomPreviewScene::GetNumPooledActors() const
+{
+	int32 NumPooledActors = 0;
+
+	for (const TPair<UClass*, TArray<AActor*>>& Pair : ActorPool)
+	{
+		NumPooledActors += Pair.Value.Num();
+	}
+
+	return NumPooledActors;
+}
+
+static TAutoConsoleVariable<float> CVarTexturePrimeSeconds(
+	TEXT("ViewportWidget.TexturePrimeSeconds"),
+	5.f,
+	TEXT("Seconds the texture streamer keeps a boosted view on newly spawned entries, so their textures stream in at full resolution right away. 0 disables priming."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTexturePrimeBoost(
+	TEXT("ViewportWidget.TexturePrimeBoost"),
+	2.f,
+	TEXT("Boost factor of the streaming view priming newly spawned entries, higher values request sharper mips."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTexturePrimeBudget(
+	TEXT("ViewportWidget.TexturePrimeBudgetMB"),
+	64.f,
+	TEXT("Megabytes of not yet streamed in textures each preview world may prime at once, entries exceeding it stream in regularly. 0 is unlimited."),
+	ECVF_Default);
+
+void FCustomPreviewScene::PrimeTextures(AActor* Actor, float ScreenSize)
+{
+	const float PrimeSeconds = CVarTexturePrimeSeconds.GetValueOnGameThread();
+
+	if (bForceAllUsedMipsResident || PrimeSeconds <= 0.f || ScreenSize <= 0.f || !IStreamingManager::Get().IsTextureStreamingEnabled())
+	{
+		return;
+	}
+
+	const int64 BudgetBytes = (int64)(CVarTexturePrimeBudget.GetValueOnGameThread() * 1024.f * 1024.f);
+	const double Now = FPlatformTime::Seconds();
+
+	TArray<UTexture*> UsedTextures;
+
+	Actor->ForEachComponent<UPrimitiveComponent>(false, [&UsedTextures](UPrimitiveComponent* Primitive)
+		{
+			Primitive->GetUsedTextures(UsedTextures, EMaterialQualityLevel::Num);
+		});
+
+	TArray<UTexture*, TInlineAllocator<16>> NewTextures;
+	int64 NewBytes = 0;
+
+	for (UTexture* Texture : UsedTextures)
+	{
+		if (!Texture || !Texture->IsStreamable() || Texture->IsFullyStreamedIn() || NewTextures.Contains(Texture))
+		{
+			continue;
+		}
+
+		const bool bPriming = PrimingTextures.ContainsByPredicate([Texture](const TPair<TWeakObjectPtr<UTexture>, double>& Priming)
+			{
+				return Priming.Key.Get() == Texture;
+			});
+
+		if (!bPriming)
+		{
+			NewTextures.Add(Texture);
+			NewBytes += Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+		}
+	}
+
+	if (NewTextures.Num() == 0)
+	{
+		return;
+	}
+
+	if (BudgetBytes > 0 && PrimingBytes + NewBytes > BudgetBytes)
+	{
+		NumTexturesOverBudget += NewTextures.Num();
+		return;
+	}
+
+	// A lasting view on the actor expires by itself after PrimeSeconds and only raises wanted mips, unlike forcing residency
+	// it neither loads mips the streamer would drop under pressure nor overrides residency forced by anyone else.
+	// Views aren't tied to a world, so textures of other worlds near the same location are boosted as well for that time.
+	// The view sits on the actor, a 90 degree FOV makes the FOV screen size equal the screen size.
+	IStreamingManager::Get().AddViewInformation(Actor->GetActorLocation(), ScreenSize, ScreenSize, CVarTexturePrimeBoost.GetValueOnGameThread(), false, PrimeSeconds, Actor);
+
+	for (UTexture* Texture : NewTextures)
+	{
+		PrimingTextures.Emplace(Texture, Now);
+	}
+
+	PrimingBytes += NewBytes;
+}
+
+void FCustomPreviewScene::TickTexturePriming()
+{
+	if (PrimingTextures.Num() == 0)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const float PrimeSeconds = CVarTexturePrimeSeconds.GetValueOnGameThread();
+
+	for (int32 Index = PrimingTextures.Num() - 1; Index >= 0; --Index)
+	{
+		UTexture* Texture = PrimingTextures[Index].Key.Get();
+
+		if (Texture && !Texture->IsFullyStreamedIn() && Now - PrimingTextures[Index].Value < PrimeSeconds)
+		{
+			continue;
 		}
+
+		if (Texture)
+		{
+			PrimingBytes -= Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+		}
+
+		PrimingTextures.RemoveAtSwap(Index);
+	}
+
+	if (PrimingTextures.Num() == 0)
+	{
+		// Also forgets bytes of textures collected while priming
+		PrimingBytes = 0;
+	}
+}
+
+FCustomPreviewScene::FTextureStreamingStats FCustomPreviewScene::GetTextureStreamingStats() const
+{
+	FTextureStreamingStats Stats;
+	Stats.NumPrimingTextures = PrimingTextures.Num();
+	Stats.PrimingBytes = PrimingBytes;
+	Stats.NumOverBudget = NumTexturesOverBudget;
+
+	if (PreviewWorld)
+	{
+		TSet<UTexture*> WorldTextures;
+		TArray<UTexture*> UsedTextures;
+
+		for (TActorIterator<AActor> It(PreviewWorld); It; ++It)
+		{
+			It->ForEachComponent<UPrimitiveComponent>(false, [&UsedTextures](UPrimitiveComponent* Primitive)
+				{
+					Primitive->GetUsedTextures(UsedTextures, EMaterialQualityLevel::Num);
+				});
+
+			WorldTextures.Append(UsedTextures);
+			UsedTextures.Reset();
+		}
+
+		for (UTexture* Texture : WorldTextures)
+		{
+			if (Texture)
+			{
+				Stats.ResidentBytes += Texture->CalcTextureMemorySizeEnum(TMC_ResidentMips);
+			}
+		}
+	}
+
+	return Stats;
+}
+
+int32 FCustomPreviewScene::GetNumPooledActors(UClass* ActorClass) const
+{
+	const TArray<AActor*>* PooledActors = ActorPool.Find(ActorClass);
+
+	return PooledActors ? PooledActors->Num() : 0;
+}
+
+void FCustomPreviewScene::EmptyActorPool()
+{
+	// Pooled actors are part of the cluster, destroying them inside it would leave the cluster pointing at garbage
+	DissolveGCCluster();
+
+	for (TPair<UClass*, TArray<AActor*>>& Pair : ActorPool)
+	{
+		for (AActor* Actor : Pair.Value)
+		{
+			if (IsValid(Actor))
+			{
+				Actor->Destroy();
+			}
+		}
+	}
+
+	ActorPool.Empty();
+	PooledActorStates.Empty();
+}
+
+void FCustomPreviewScene::AddComponent(UActorComponent* Component, const FTransform& LocalToWorld, bool bAttachToRoot /*= false*/)
+{
+	Components.AddUnique(Component);
+
+	USceneComponent* SceneComp = Cast<USceneComponent>(Component);
+	if (SceneComp && SceneComp->GetAttachParent() == NULL)
+	{
+		SceneComp->SetRelativeTransform(LocalToWorld);
+	}
+
+	Component->RegisterComponentWithWorld(PreviewWorld);
+
+	if (bForceAllUsedMipsResident)
+	{
+		// Add a mip streaming override to the new mesh
+		UMeshComponent* pMesh = Cast<UMeshComponent>(Component);
+		if (pMesh != NULL)
+		{
+			pMesh->SetTextureForceResidentFlag(true);
+		}
+	}
+
+	{
+		UStaticMeshComponent* pStaticMesh = Cast<UStaticMeshComponent>(Component);
+		if (pStaticMesh != nullptr)
+		{
+			pStaticMesh->bEvaluateWorldPositionOffset = true;
+			pStaticMesh->bEvaluateWorldPositionOffsetInRayTracing = true;
+		}
+	}
+
+	PreviewWorld->Scene->UpdateSpeedTreeWind(0.0);
+}
+
+void FCustomPreviewScene::RemoveComponent(UActorComponent* Component)
+{
+	Component->UnregisterComponent();
+	Components.Remove(Component);
+
+	if (bForceAllUsedMipsResident)
+	{
+		// Remove the mip streaming override on the old mesh
+		UMeshComponent* pMesh = Cast<UMeshComponent>(Component);
+		if (pMesh != NULL)
+		{
+			pMesh->SetTextureForceResidentFlag(false);
+		}
+	}
+}
+
+void FCustomPreviewScene::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObjects(Components);
+	Collector.AddReferencedObject(PreviewWorld);
+	Collector.AddReferencedObject(GCClusterRoot);
+	Collector.AddReferencedObject(InitValues.OwningGameInstance);
+
+	for (TPair<UClass*, TArray<AActor*>>& Pair : ActorPool)
+	{
+		Collector.AddReferencedObject(Pair.Key);
+		Collector.AddReferencedObjects(Pair.Value);
+	}
+}
+
+int32 FCustomPreviewScene::GetNumWorldSubsystems() const
+{
+	return PreviewWorld ? PreviewWorld->GetSubsystemArray<UWorldSubsystem>().Num() : 0;
+}
+
+EObjectFlags FCustomPreviewScene::GetSpawnObjectFlags() const
+{
+	// Undo support is an editor feature, transactional objects only cost GC and memory at runtime
+	return (bTransactional && GIsEditor) ? RF_Transient | RF_Transactional : RF_Transient;
+}
+
+void FCustomPreviewScene::CreateGCCluster()
+{
+	DissolveGCCluster();
+
+	static const IConsoleVariable* CVarEngineCreateGCClusters = IConsoleManager::Get().FindConsoleVariable(TEXT("gc.CreateGCClusters"));
+
+	if (!bCreateGCCluster || !PreviewWorld || !PreviewWorld->PersistentLevel || (CVarEngineCreateGCClusters && !CVarEngineCreateGCClusters->GetBool()))
+	{
+		return;
+	}
+
+	TArray<AActor*> ClusterActors;
+
+	// Entry actors that change every frame, e.g. animated skeletal meshes, create and drop references a cluster can't track
+	auto IsDynamic = [](AActor* Actor)
+		{
+			bool bDynamic = Actor->IsActorTickEnabled();
+
+			Actor->ForEachComponent(false, [&bDynamic](UActorComponent* Component)
+				{
+					bDynamic |= Component->IsComponentTickEnabled() || Component->IsA<USkinnedMeshComponent>();
+				});
+
+			return bDynamic;
+		};
+
+	for (AActor* Actor : PreviewWorld->PersistentLevel->Actors)
+	{
+		if (IsValid(Actor) && Actor != PreviewWorld->GetWorldSettings(false) && Actor->CanBeInCluster() && !IsDynamic(Actor))
+		{
+			ClusterActors.Add(Actor);
+		}
+	}
+
+	if (ClusterActors.Num() > 0)
+	{
+		// Same cluster root levels use for their actors, it collects the actors' components and other inner objects too
+		GCClusterRoot = NewObject<ULevelActorContainer>(PreviewWorld->PersistentLevel, NAME_None, RF_Transient);
+		GCClusterRoot->Actors = MoveTemp(ClusterActors);
+		GCClusterRoot->CreateCluster();
+	}
+}
+
+void FCustomPreviewScene::DissolveGCCluster()
+{
+	if (GCClusterRoot)
+	{
+		if (GCClusterRoot->HasAnyInternalFlags(EInternalObjectFlags::ClusterRoot))
+		{
+			GUObjectClusters.DissolveCluster(GCClusterRoot);
+		}
+
+		GCClusterRoot->Actors.Reset();
+		GCClusterRoot->MarkAsGarbage();
+		GCClusterRoot = nullptr;
+	}
+}
+
+FString FCustomPreviewScene::GetReferencerName() const
+{
+	return TEXT("FCustomPreviewScene");
+}
+
+void FCustomPreviewScene::UpdateCaptureContents()
+{
+	VIEWPORTWIDGET_SCOPE(UpdateCaptureContents);
+
+	// This function is called from FAdvancedPreviewScene::Tick, FBlueprintEditor::Tick, and FThumbnailPreviewScene::Tick,
+	// so assume we are inside a Tick function.
+	const bool bInsideTick = true;
+
+	LastCaptureUpdateTime = FPlatformTime::Seconds();
+
+	USkyLightComponent::UpdateSkyCaptureContents(PreviewWorld);
+	UReflectionCaptureComponent::UpdateReflectionCaptureContents(PreviewWorld, nullptr, false, false, bInsideTick);
+}
+
+FViewportWidgetMemoryUsage FCustomPreviewScene::GetMemoryUsage() const
+{
+	FViewportWidgetMemoryUsage MemoryUsage;
+
+	if (PreviewWorld)
+	{
+		TArray<UObject*> Objects;
+		Objects.Add(PreviewWorld);
+		GetObjectsWithOuter(PreviewWorld, Objects, true);
+
+		// Components added through AddComponent may be outered elsewhere, e.g. to the transient package
+		for (UActorComponent* Component : Components)
+		{
+			if (Component)
+			{
+				Objects.AddUnique(Component);
+			}
+		}
+
+		for (UObject* Object : Objects)
+		{
+			MemoryUsage.UObjectBytes += FArchiveCountMem(Object).GetMax();
+			MemoryUsage.RenderResourceBytes += Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+		}
+
+		MemoryUsage.NumObjects = Objects.Num();
+	}
+
+	return MemoryUsage;
+}
+
+void FCustomPreviewScene::ClearLineBatcher()
+{
+	VIEWPORTWIDGET_SCOPE(ClearLineBatcher);
+
+	if (LineBatcher != NULL)
+	{
+		LineBatcher->Flush();
+	}
+}
+
+//------------------------------------------------------
+// FViewportRenderTargetPool
+//------------------------------------------------------
+
+static TAutoConsoleVariable<float> CVarRenderTargetPoolIdleTime(
+	TEXT("ViewportWidget.RenderTargetPoolIdleTime"),
+	10.f,
+	TEXT("Seconds a pooled viewport widget render target may stay unused before it is freed."),
+	ECVF_Default);
+
+static FAutoConsoleCommand DumpRenderTargetPoolCommand(
+	TEXT("ViewportWidget.DumpRenderTargetPool"),
+	TEXT("Logs memory counters of the viewport widget render target pool."),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const FViewportRenderTargetPool& Pool = FViewportRenderTargetPool::Get();
+			UE_LOG(LogViewportWidget, Display, TEXT("Render target pool: %d pooled, %d borrowed, %llu bytes. Cached copies: %llu bytes"),
+				Pool.GetNumPooled(),
+				Pool.GetNumBorrowed(),
+				(uint64)Pool.GetPoolBytes(),
+				(uint64)Pool.GetCachedCopyBytes());
+
+			for (const TPair<EPixelFormat, SIZE_T>& Pair : Pool.GetCachedCopyBytesByFormat())
+			{
+				UE_LOG(LogViewportWidget, Display, TEXT("  %s cached copies: %llu bytes"), GetPixelFormatString(Pair.Key), (uint64)Pair.Value);
+			}
+		}));
+
+FViewportRenderTargetPool& FViewportRenderTargetPool::Get()
+{
+	static FViewportRenderTargetPool Pool;
+	return Pool;
+}
+
+UTextureRenderTarget2D* FViewportRenderTargetPool::Acquire(const FIntPoint& Size, EPixelFormat Format)
+{
+	UTextureRenderTarget2D* RenderTarget = nullptr;
+
+	TArray<FPooledRenderTarget>* PooledRenderTargets = FreeRenderTargets.Find(FPoolKey{ Size, Format });
+	if (PooledRenderTargets && PooledRenderTargets->Num() > 0)
+	{
+		RenderTarget = PooledRenderTargets->Pop(false).RenderTarget;
+	}
+	else
+	{
+		RenderTarget = CreateRenderTarget(Size, Format);
+		PoolBytes += CalcRenderTargetBytes(RenderTarget);
+	}
+
+	BorrowedRenderTargets.Add(RenderTarget);
+
+	return RenderTarget;
+}
+
+void FViewportRenderTargetPool::Release(UTextureRenderTarget2D* RenderTarget)
+{
+	if (RenderTarget && BorrowedRenderTargets.RemoveSingleSwap(RenderTarget) > 0)
+	{
+		const FPoolKey Key{ FIntPoint(RenderTarget->SizeX, RenderTarget->SizeY), RenderTarget->GetFormat() };
+		FreeRenderTargets.FindOrAdd(Key).Add(FPooledRenderTarget{ RenderTarget, FPlatformTime::Seconds() });
+	}
+}
+
+void FViewportRenderTargetPool::Trim(double MaxIdleSeconds)
+{
+	const double CurrentTime = FPlatformTime::Seconds();
+
+	for (auto It = FreeRenderTargets.CreateIterator(); It; ++It)
+	{
+		TArray<FPooledRenderTarget>& PooledRenderTargets = It.Value();
+
+		for (int32 Index = PooledRenderTargets.Num() - 1; Index >= 0; --Index)
+		{
+			if (CurrentTime - PooledRenderTargets[Index].LastUseTime > MaxIdleSeconds)
+			{
+				UTextureRenderTarget2D* RenderTarget = PooledRenderTargets[Index].RenderTarget;
+				PoolBytes -= CalcRenderTargetBytes(RenderTarget);
+				RenderTarget->ReleaseResource();
+
+				PooledRenderTargets.RemoveAtSwap(Index, 1, false);
+			}
+		}
+
+		if (PooledRenderTargets.Num() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+UTextureRenderTarget2D* FViewportRenderTargetPool::CreateCachedCopy(const FIntPoint& Size, EPixelFormat Format)
+{
+	UTextureRenderTarget2D* RenderTarget = CreateRenderTarget(Size, Format);
+	const SIZE_T Bytes = CalcRenderTargetBytes(RenderTarget);
+
+	CachedCopyBytes += Bytes;
+	CachedCopyBytesByFormat.FindOrAdd(Format) += Bytes;
+
+	return RenderTarget;
+}
+
+void FViewportRenderTargetPool::ReleaseCachedCopy(UTextureRenderTarget2D* RenderTarget)
+{
+	if (RenderTarget)
+	{
+		const SIZE_T Bytes = CalcRenderTargetBytes(RenderTarget);
+		const EPixelFormat Format = RenderTarget->GetFormat();
+
+		CachedCopyBytes -= Bytes;
+
+		if (SIZE_T* FormatBytes = CachedCopyBytesByFormat.Find(Format))
+		{
+			*FormatBytes -= Bytes;
+
+			if (*FormatBytes == 0)
+			{
+				CachedCopyBytesByFormat.Remove(Format);
+			}
+		}
+
+		RenderTarget->ReleaseResource();
+	}
+}
+
+SIZE_T FViewportRenderTargetPool::GetCachedCopyBytes(EPixelFormat Format) const
+{
+	const SIZE_T* Bytes = CachedCopyBytesByFormat.Find(Format);
+	return Bytes ? *Bytes : 0;
+}
+
+int32 FViewportRenderTargetPool::GetNumPooled() const
+{
+	int32 NumPooled = 0;
+
+	for (const TPair<FPoolKey, TArray<FPooledRenderTarget>>& Pair : FreeRenderTargets)
+	{
+		NumPooled += Pair.Value.Num();
+	}
+
+	return NumPooled;
+}
+
+SIZE_T FViewportRenderTargetPool::CalcRenderTargetBytes(const UTextureRenderTarget2D* RenderTarget)
+{
+	return RenderTarget ? CalcTextureSize(RenderTarget->SizeX, RenderTarget->SizeY, RenderTarget->GetFormat(), 1) : 0;
+}
+
+void FViewportRenderTargetPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (TPair<FPoolKey, TArray<FPooledRenderTarget>>& Pair : FreeRenderTargets)
+	{
+		for (FPooledRenderTarget& PooledRenderTarget : Pair.Value)
+		{
+			Collector.AddReferencedObject(PooledRenderTarget.RenderTarget);
+		}
+	}
+
+	Collector.AddReferencedObjects(BorrowedRenderTargets);
+}
+
+UTextureRenderTarget2D* FViewportRenderTargetPool::CreateRenderTarget(const FIntPoint& Size, EPixelFormat Format)
+{
+	UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>(GetTransientPackage(), NAME_None, RF_Transient);
+	RenderTarget->ClearColor = FLinearColor::Transparent;
+	RenderTarget->InitCustomFormat(Size.X, Size.Y, Format, Format != PF_FloatRGBA);
+	RenderTarget->UpdateResourceImmediate(true);
+	return RenderTarget;
+}
+
+//------------------------------------------------------
+// FCustomViewportPostProcessLayers
+//------------------------------------------------------
+
+TSharedRef<const FCustomViewportPostProcessLayers> FCustomViewportPostProcessLayers::Create(const TArray<FViewportWidgetPostProcessLayer>& InLayers)
+{
+	return MakeShareable(new FCustomViewportPostProcessLayers(InLayers));
+}
+
+FCustomViewportPostProcessLayers::FCustomViewportPostProcessLayers(const TArray<FViewportWidgetPostProcessLayer>& InLayers)
+	: Layers(InLayers)
+{
+	for (int32 LayerIndex = 0; LayerIndex < Layers.Num(); ++LayerIndex)
+	{
+		const FViewportWidgetPostProcessLayer& Layer = Layers[LayerIndex];
+
+		if (Layer.Weight <= 0.f)
+		{
+			continue;
+		}
+
+		// Blendables have no override flag, they are blended whenever present
+		if (Layer.Settings.WeightedBlendables.Array.Num() > 0)
+		{
+			ActiveLayerIndices.Add(LayerIndex);
+			continue;
+		}
+
+		for (TFieldIterator<FBoolProperty> It(FPostProcessSettings::StaticStruct()); It; ++It)
+		{
+			if (It->GetName().StartsWith(TEXT("bOverride_")) && It->GetPropertyValue_InContainer(&Layer.Settings))
+			{
+				ActiveLayerIndices.Add(LayerIndex);
+				break;
+			}
+		}
+	}
+}
+
+void FCustomViewportPostProcessLayers::ApplyTo(FSceneView& View) const
+{
+	// Each layer blends over what the view has so far, volumes and earlier layers included
+	for (const int32 LayerIndex : ActiveLayerIndices)
+	{
+		View.OverridePostProcessSettings(Layers[LayerIndex].Settings, Layers[LayerIndex].Weight);
+	}
+}
+
+void FCustomViewportPostProcessLayers::AddReferencedObjects(FReferenceCollector& Collector) const
+{
+	// Blendables, LUTs and lens textures must outlive every preview rendering with them
+	for (const FViewportWidgetPostProcessLayer& Layer : Layers)
+	{
+		Collector.AddPropertyReferences(FViewportWidgetPostProcessLayer::StaticStruct(), const_cast<FViewportWidgetPostProcessLayer*>(&Layer));
+	}
+}
+
+//------------------------------------------------------
+// UViewportWidgetPostProcessAsset
+//------------------------------------------------------
+
+TSharedRef<const FCustomViewportPostProcessLayers> UViewportWidgetPostProcessAsset::GetLayerSet() const
+{
+	if (!LayerSet.IsValid())
+	{
+		LayerSet = FCustomViewportPostProcessLayers::Create(Layers);
+	}
+
+	return LayerSet.ToSharedRef();
+}
+
+#if WITH_EDITOR
+void UViewportWidgetPostProcessAsset::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// Widgets pick the new set up when they are synchronized again
+	LayerSet.Reset();
+}
+#endif
+
+//------------------------------------------------------
+// FCustomViewportGroup
+//------------------------------------------------------
+
+FCustomViewportGroup::FCustomViewportGroup(const TSharedRef<FCustomPreviewScene>& InPreviewScene)
+	: PreviewScene(InPreviewScene)
+	, RenderTarget(nullptr)
+	, LastTickFrame(0)
+	, LastDrawFrame(0)
+	, NumViewsDrawn(0)
+{}
+
+FCustomViewportGroup::~FCustomViewportGroup()
+{
+	if (RenderTarget)
+	{
+		FViewportRenderTargetPool::Get().ReleaseCachedCopy(RenderTarget);
+		RenderTarget = nullptr;
+	}
+
+	for (UTextureRenderTarget2D* RetiredRenderTarget : RetiredRenderTargets)
+	{
+		FViewportRenderTargetPool::Get().ReleaseCachedCopy(RetiredRenderTarget);
+	}
+}
+
+void FCustomViewportGroup::AddWidget(SViewportWidget* Widget)
+{
+	Widgets.AddUnique(Widget);
+}
+
+void FCustomViewportGroup::RemoveWidget(SViewportWidget* Widget)
+{
+	Widgets.Remove(Widget);
+
+	ReleaseRetiredRenderTargets();
+}
+
+void FCustomViewportGroup::Tick(float DeltaTime)
+{
+	if (LastTickFrame == GFrameCounter || !PreviewScene->IsReady())
+	{
+		return;
+	}
+
+	LastTickFrame = GFrameCounter;
+
+	PreviewScene->UpdateCaptureContents();
+	PreviewScene->ClearLineBatcher();
+	PreviewScene->TickTexturePriming();
+
+	if (UWorld* World = PreviewScene->GetWorld())
+	{
+		VIEWPORTWIDGET_SCOPE(WorldTick);
+
+		World->Tick(ELevelTick::LEVELTICK_All, DeltaTime);
+	}
+}
+
+void FCustomViewportGroup::Draw()
+{
+	if (LastDrawFrame == GFrameCounter)
+	{
+		return;
+	}
+
+	LastDrawFrame = GFrameCounter;
+
+	VIEWPORTWIDGET_SCOPE(DrawGroup);
+
+	UWorld* World = PreviewScene->GetWorld();
+
+	if (!World)
+	{
+		return;
+	}
+
+	// Visible members are packed in rows about as wide as the target is high, so it stays within the maximum texture size
+	TArray<SViewportWidget*, TInlineAllocator<8>> VisibleWidgets;
+	EPixelFormat Format = PF_B8G8R8A8;
+	int64 TotalArea = 0;
+	int32 MaxMemberWidth = 0;
+	const int32 MaxDimension = (int32)GetMax2DTextureDimension();
+
+	for (SViewportWidget* Widget : Widgets)
+	{
+		const FIntPoint Size = Widget->SceneViewport.IsValid() ? Widget->SceneViewport->GetSizeXY() : FIntPoint::ZeroValue;
+
+		if (Widget->Client.IsValid() && Widget->IsVisible() && Size.X > 0 && Size.Y > 0 && Size.X <= MaxDimension && Size.Y <= MaxDimension)
+		{
+			VisibleWidgets.Add(Widget);
+
+			TotalArea += (int64)Size.X * Size.Y;
+			MaxMemberWidth = FMath::Max(MaxMemberWidth, Size.X);
+
+			if (Widget->SceneViewport->IsHDRViewport())
+			{
+				Format = PF_FloatRGBA;
+			}
+		}
+	}
+
+	const int32 RowWidth = FMath::Clamp((int32)FMath::CeilToInt(FMath::Sqrt((double)TotalArea)), MaxMemberWidth, MaxDimension);
+
+	TArray<SViewportWidget*, TInlineAllocator<8>> DrawnWidgets;
+	TArray<FCustomViewportClient*, TInlineAllocator<8>> Clients;
+	TArray<FIntPoint, TInlineAllocator<8>> ViewOffsets;
+	FIntPoint RequiredSize(0, 0);
+	FIntPoint RowOffset(0, 0);
+	int32 RowHeight = 0;
+
+	for (SViewportWidget* Widget : VisibleWidgets)
+	{
+		const FIntPoint Size = Widget->SceneViewport->GetSizeXY();
+
+		if (RowOffset.X > 0 && RowOffset.X + Size.X > RowWidth)
+		{
+			RowOffset = FIntPoint(0, RowOffset.Y + RowHeight);
+			RowHeight = 0;
+		}
+
+		if (RowOffset.Y + Size.Y > MaxDimension)
+		{
+			// Keeps showing its last frame until the others leave room
+			UE_LOG(LogViewportWidget, Verbose, TEXT("Group render target is full, a %dx%d member is not drawn this frame"), Size.X, Size.Y);
+			continue;
+		}
+
+		DrawnWidgets.Add(Widget);
+		Clients.Add(Widget->Client.Get());
+		ViewOffsets.Add(RowOffset);
+
+		RowOffset.X += Size.X;
+		RowHeight = FMath::Max(RowHeight, Size.Y);
+		RequiredSize = RequiredSize.ComponentMax(FIntPoint(RowOffset.X, RowOffset.Y + Size.Y));
+	}
+
+	NumViewsDrawn = Clients.Num();
+
+	if (NumViewsDrawn == 0)
+	{
+		return;
+	}
+
+	// Grows to the largest size needed so far, so members resizing every frame don't reallocate the target,
+	// and shrinks to the required size once it is less than half as wide or high
+	const bool bGrow = !RenderTarget || RenderTarget->SizeX < RequiredSize.X || RenderTarget->SizeY < RequiredSize.Y;
+	const bool bShrink = RenderTarget && (RequiredSize.X * 2 <= RenderTarget->SizeX || RequiredSize.Y * 2 <= RenderTarget->SizeY);
+
+	if (bGrow || bShrink || RenderTarget->GetFormat() != Format)
+	{
+		const FIntPoint NewSize = RenderTarget && !bShrink ? RequiredSize.ComponentMax(FIntPoint(RenderTarget->SizeX, RenderTarget->SizeY)) : RequiredSize;
+
+		if (RenderTarget)
+		{
+			// Members not drawn this frame still show it, it is released once none of them does
+			RetiredRenderTargets.Add(RenderTarget);
+		}
+
+		RenderTarget = FViewportRenderTargetPool::Get().CreateCachedCopy(NewSize, Format);
+	}
+
+	{
+		FCanvas Canvas(RenderTarget->GameThread_GetRenderTargetResource(), nullptr, World, World->GetFeatureLevel());
+		FCustomViewportClient::DrawViewFamily(&Canvas, Clients, ViewOffsets);
+		Canvas.Flush_GameThread();
+	}
+
+	for (int32 WidgetIndex = 0; WidgetIndex < DrawnWidgets.Num(); ++WidgetIndex)
+	{
+		const FIntPoint& ViewOffset = ViewOffsets[WidgetIndex];
+		DrawnWidgets[WidgetIndex]->OnDrawnInGroup(RenderTarget, FIntRect(ViewOffset, ViewOffset + DrawnWidgets[WidgetIndex]->SceneViewport->GetSizeXY()));
+	}
+
+	ReleaseRetiredRenderTargets();
+}
+
+void FCustomViewportGroup::ReleaseRetiredRenderTargets()
+{
+	for (int32 Index = RetiredRenderTargets.Num() - 1; Index >= 0; --Index)
+	{
+		UTextureRenderTarget2D* RetiredRenderTarget = RetiredRenderTargets[Index];
+
+		const bool bShown = Widgets.ContainsByPredicate([RetiredRenderTarget](const SViewportWidget* Widget)
+			{
+				return Widget->CachedBrush.GetResourceObject() == RetiredRenderTarget;
+			});
+
+		if (!bShown)
+		{
+			FViewportRenderTargetPool::Get().ReleaseCachedCopy(RetiredRenderTarget);
+			RetiredRenderTargets.RemoveAtSwap(Index);
+		}
+	}
+}
+
+SIZE_T FCustomViewportGroup::GetRenderTargetBytes() const
+{
+	SIZE_T Bytes = FViewportRenderTargetPool::CalcRenderTargetBytes(RenderTarget);
+
+	for (const UTextureRenderTarget2D* RetiredRenderTarget : RetiredRenderTargets)
+	{
+		Bytes += FViewportRenderTargetPool::CalcRenderTargetBytes(RetiredRenderTarget);
+	}
+
+	return Bytes;
+}
+
+void FCustomViewportGroup::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObject(RenderTarget);
+	Collector.AddReferencedObjects(RetiredRenderTargets);
+}
+
+//------------------------------------------------------
+// SViewportWidget
+//------------------------------------------------------
+
+static TAutoConsoleVariable<float> CVarMemoryBudget(
+	TEXT("ViewportWidget.MemoryBudgetMB"),
+	0.f,
+	TEXT("Memory all viewport widgets may hold in megabytes, exceeding it logs a warning. Checked every ViewportWidget.MemoryBudgetCheckInterval seconds, 0 disables the check."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMemoryBudgetCheckInterval(
+	TEXT("ViewportWidget.MemoryBudgetCheckInterval"),
+	10.f,
+	TEXT("Seconds between memory budget checks, the check serializes all preview scene objects."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarCreateGCClusters(
+	TEXT("ViewportWidget.CreateGCClusters"),
+	0,
+	TEXT("1 puts the actors of every new standalone or group preview scene into a GC cluster, rebuilt when entries change. Requires gc.CreateGCClusters."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarMinimalPreviewScenes(
+	TEXT("ViewportWidget.MinimalPreviewScenes"),
+	0,
+	TEXT("1 creates new standalone or group preview scenes with the minimal profile: no FX system, line batcher, audio or transactional objects."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarSwapSpawnBudget(
+	TEXT("ViewportWidget.SwapSpawnBudgetMs"),
+	2.f,
+	TEXT("Milliseconds a widget may spend per frame spawning the hidden entries of a pending SwapEntries, at least one entry is spawned per frame."),
+	ECVF_Default);
+
+namespace ViewportWidgetStreaming_NM
+{
+	FStreamableManager& GetStreamableManager()
+	{
+		if (UAssetManager::IsInitialized())
+		{
+			return UAssetManager::GetStreamableManager();
+		}
+
+		static FStreamableManager StreamableManager;
+		return StreamableManager;
+	}
+
+	/** @return Handle loading the entry classes not loaded yet, null if all of them are */
+	TSharedPtr<FStreamableHandle> RequestEntryClasses(const TArray<FViewportWidgetEntry>& Entries, TAsyncLoadPriority Priority = FStreamableManager::DefaultAsyncLoadPriority)
+	{
+		TArray<FSoftObjectPath> ClassPaths;
+
+		for (const FViewportWidgetEntry& Entry : Entries)
+		{
+			if (Entry.ActorClassPtr.IsPending())
+			{
+				ClassPaths.AddUnique(Entry.ActorClassPtr.ToSoftObjectPath());
+			}
+		}
+
+		return ClassPaths.Num() > 0 ? GetStreamableManager().RequestAsyncLoad(MoveTemp(ClassPaths), FStreamableDelegate(), Priority) : nullptr;
+	}
+}
+
+/** Entries of a SwapEntries call, spawned hidden next to the shown ones and swapped in once all of them are */
+struct FViewportWidgetPendingSwap
+{
+	TArray<FViewportWidgetEntry> Entries;
+
+	TSharedPtr<FStreamableHandle> LoadHandle;
+
+	int32 NumSpawned = 0;
+
+	/** Set once the new entries are shown, the old actors wait for the first frame showing them to be rendered */
+	bool bSwapped = false;
+
+	bool bFenceIssued = false;
+
+	TArray<TWeakObjectPtr<AActor>> OldActors;
+
+	FRenderCommandFence RenderedFence;
+};
+
+static TAutoConsoleVariable<int32> CVarMaxPrefetches(
+	TEXT("ViewportWidget.MaxPrefetches"),
+	4,
+	TEXT("Entry sets each widget keeps prefetched, the oldest is dropped when another one is prefetched."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPrefetchSpawnsPerFrame(
+	TEXT("ViewportWidget.PrefetchSpawnsPerFrame"),
+	1,
+	TEXT("Dormant actors each widget pre-spawns into the actor pool per frame for prefetched entries, only while no swap is spawning."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarDelayShowUntilPSOsPrecached(
+	TEXT("ViewportWidget.DelayShowUntilPSOsPrecached"),
+	0,
+	TEXT("1 keeps new entry actors hidden while their PSOs are still compiling, so they don't hitch or show fallback materials when first drawn."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPSOPrecacheShowTimeout(
+	TEXT("ViewportWidget.PSOPrecacheShowTimeout"),
+	2.f,
+	TEXT("Seconds an entry actor is kept hidden at most waiting for its PSOs with ViewportWidget.DelayShowUntilPSOsPrecached."),
+	ECVF_Default);
+
+namespace ViewportWidgetPSOPrecache_NM
+{
+	/** Requests PSOs for the primitive templates of the class, so they compile before the first actor is spawned */
+	void PrecacheClass(UClass* ActorClass)
+	{
+		if (!IsComponentPSOPrecachingEnabled() || !ActorClass)
+		{
+			return;
+		}
+
+		TInlineComponentArray<UPrimitiveComponent*> Primitives;
+		ActorClass->GetDefaultObject<AActor>()->GetComponents(Primitives);
+
+		for (UBlueprintGeneratedClass* BlueprintClass = Cast<UBlueprintGeneratedClass>(ActorClass); BlueprintClass; BlueprintClass = Cast<UBlueprintGeneratedClass>(BlueprintClass->GetSuperClass()))
+		{
+			if (BlueprintClass->SimpleConstructionScript)
+			{
+				for (USCS_Node* Node : BlueprintClass->SimpleConstructionScript->GetAllNodes())
+				{
+					if (UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Node->ComponentTemplate))
+					{
+						Primitives.Add(Primitive);
+					}
+				}
+			}
+		}
+
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			Primitive->PrecachePSOs();
+		}
+	}
+
+	bool IsCompiling(AActor* Actor)
+	{
+		bool bCompiling = false;
+
+		Actor->ForEachComponent<UPrimitiveComponent>(false, [&bCompiling](UPrimitiveComponent* Primitive)
+			{
+				bCompiling |= Primitive->IsPSOPrecaching();
+			});
+
+		return bCompiling;
+	}
+
+	/** @return True if PSOs of any primitive of the actor are still compiling */
+	bool PrecacheActor(AActor* Actor)
+	{
+		if (!IsComponentPSOPrecachingEnabled())
+		{
+			return false;
+		}
+
+		bool bCompiling = false;
+
+		Actor->ForEachComponent<UPrimitiveComponent>(false, [&bCompiling](UPrimitiveComponent* Primitive)
+			{
+				// Registered components requested theirs already, this only catches the ones that didn't
+				Primitive->PrecachePSOs();
+
+				bCompiling |= Primitive->IsPSOPrecaching();
+			});
+
+		return bCompiling;
+	}
+}
+
+/** Entries of a PrefetchEntries call, their classes are kept loaded until the entries are shown or the prefetch is dropped */
+struct FViewportWidgetPrefetch
+{
+	TArray<FViewportWidgetEntry> Entries;
+
+	TSharedPtr<FStreamableHandle> LoadHandle;
+
+	bool bPreSpawn = false;
+
+	bool bPSOsPrecached = false;
+
+	/** Next entry to pre-spawn an actor for */
+	int32 NextEntryIndex = 0;
+};
+
+static TAutoConsoleVariable<int32> CVarTrackEntryCosts(
+	TEXT("ViewportWidget.TrackEntryCosts"),
+	0,
+	TEXT("1 - Times the ticks of entry actors and their components as part of the preview world tick, reported as TickMs by GetEntryCosts and ViewportWidget.EntryCostReport."),
+	ECVF_Default);
+
+/**
+ * Runs a game thread tick function of an entry in its place and adds up how long it took. The target stays enabled or disabled
+ * by gameplay code as before, it is only unregistered, so the copy follows its enabled state and steps back once anyone registers it again.
+ */
+struct FViewportWidgetTimedTickFunction : public FTickFunction
+{
+	/** Actor or component the target belongs to, the target is only touched while it is alive */
+	TWeakObjectPtr<UObject> TargetOwner;
+
+	FTickFunction* Target = nullptr;
+
+	double* TickSeconds = nullptr;
+
+	FTickFunction* GetTarget() const
+	{
+		return TargetOwner.IsValid() ? Target : nullptr;
+	}
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override
+	{
+		FTickFunction* LiveTarget = GetTarget();
+
+		// Registered again, e.g. by a component registered anew, the level ticks it itself
+		if (!LiveTarget || LiveTarget->IsTickFunctionRegistered() || !LiveTarget->IsTickFunctionEnabled())
+		{
+			return;
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+
+		LiveTarget->ExecuteTick(DeltaTime, TickType, CurrentThread, MyCompletionGraphEvent);
+
+		*TickSeconds += FPlatformTime::Seconds() - StartTime;
+	}
+
+	virtual FString DiagnosticMessage() override
+	{
+		FTickFunction* LiveTarget = GetTarget();
+		return LiveTarget ? LiveTarget->DiagnosticMessage() + TEXT("[Timed]") : TEXT("[Timed, target destroyed]");
+	}
+};
+
+/**
+ * Times an entry actor during the real world tick. Its registered game thread tick functions are unregistered and run by timed copies
+ * in the same tick groups, with the same prerequisites, until the timer is destroyed. Ticks running on any thread are not timed,
+ * and tick functions of other actors depending on the entry's lose that ordering while it is timed.
+ * Components added or removed later are picked up by UpdateEntryTickTimers through NeedsRebuild.
+ */
+struct FViewportWidgetEntryTickTimer
+{
+	TWeakObjectPtr<AActor> Actor;
+
+	TArray<TUniquePtr<FViewportWidgetTimedTickFunction>> TickFunctions;
+
+	/** Components of the actor when the copies were made */
+	TArray<TWeakObjectPtr<UActorComponent>> Components;
+
+	double TickSeconds = 0.0;
+
+	int32 NumFrames = 0;
+
+	/** A group member may have ticked the shared world already in the frame the timer was created */
+	uint64 CreatedFrame;
+
+	FViewportWidgetEntryTickTimer(AActor* InActor)
+		: Actor(InActor)
+		, CreatedFrame(GFrameCounter)
+	{
+		TakeOverTickFunctions();
+	}
+
+	~FViewportWidgetEntryTickTimer()
+	{
+		RestoreTickFunctions();
+	}
+
+	/** @return True if components were added or destroyed since the copies were made */
+	bool NeedsRebuild() const
+	{
+		AActor* InActor = Actor.Get();
+
+		if (!InActor)
+		{
+			return false;
+		}
+
+		TInlineComponentArray<UActorComponent*> CurrentComponents(InActor);
+
+		return CurrentComponents.Num() != Components.Num() || Components.ContainsByPredicate([&CurrentComponents](const TWeakObjectPtr<UActorComponent>& Component)
+			{
+				return !Component.IsValid() || !CurrentComponents.Contains(Component.Get());
+			});
+	}
+
+	/** Makes copies for the current components, keeping the time measured so far */
+	void Rebuild()
+	{
+		RestoreTickFunctions();
+		TakeOverTickFunctions();
+	}
+
+	void OnWorldTicked()
+	{
+		if (GFrameCounter != CreatedFrame || TickSeconds > 0.0)
+		{
+			NumFrames++;
+		}
+	}
+
+	double GetAverageTickMs() const
+	{
+		return NumFrames > 0 ? TickSeconds * 1000.0 / NumFrames : 0.0;
+	}
+
+private:
+	void TakeOverTickFunctions()
+	{
+		AActor* InActor = Actor.Get();
+
+		if (!InActor || !InActor->GetLevel())
+		{
+			return;
+		}
+
+		TArray<TPair<UObject*, FTickFunction*>> Targets;
+
+		auto AddTarget = [&Targets](UObject* Object, FTickFunction& TickFunction)
+			{
+				if (TickFunction.IsTickFunctionRegistered() && !TickFunction.bRunOnAnyThread)
+				{
+					Targets.Emplace(Object, &TickFunction);
+				}
+			};
+
+		AddTarget(InActor, InActor->PrimaryActorTick);
+
+		for (UActorComponent* Component : TInlineComponentArray<UActorComponent*>(InActor))
+		{
+			Components.Add(Component);
+
+			AddTarget(Component, Component->PrimaryComponentTick);
+		}
+
+		for (const TPair<UObject*, FTickFunction*>& Target : Targets)
+		{
+			FViewportWidgetTimedTickFunction* TickFunction = TickFunctions.Emplace_GetRef(MakeUnique<FViewportWidgetTimedTickFunction>()).Get();
+			TickFunction->TargetOwner = Target.Key;
+			TickFunction->Target = Target.Value;
+			TickFunction->TickSeconds = &TickSeconds;
+			TickFunction->bCanEverTick = true;
+			TickFunction->TickGroup = Target.Value->TickGroup;
+			TickFunction->EndTickGroup = Target.Value->EndTickGroup;
+			TickFunction->bTickEvenWhenPaused = Target.Value->bTickEvenWhenPaused;
+			TickFunction->bHighPriority = Target.Value->bHighPriority;
+			TickFunction->TickInterval = Target.Value->TickInterval;
+		}
+
+		for (int32 Index = 0; Index < Targets.Num(); ++Index)
+		{
+			// Prerequisites within the entry point at the timed copies, so the entry keeps its tick order
+			for (const FTickPrerequisite& Prerequisite : Targets[Index].Value->GetPrerequisites())
+			{
+				if (FTickFunction* PrerequisiteFunction = Prerequisite.PrerequisiteObject.IsValid() ? Prerequisite.PrerequisiteTickFunction : nullptr)
+				{
+					const int32 PrerequisiteIndex = Targets.IndexOfByPredicate([PrerequisiteFunction](const TPair<UObject*, FTickFunction*>& Target) { return Target.Value == PrerequisiteFunction; });
+
+					TickFunctions[Index]->AddPrerequisite(Prerequisite.PrerequisiteObject.Get(), PrerequisiteIndex != INDEX_NONE ? *TickFunctions[PrerequisiteIndex] : *PrerequisiteFunction);
+				}
+			}
+		}
+
+		for (int32 Index = 0; Index < Targets.Num(); ++Index)
+		{
+			// Unregistered rather than disabled, so enabling and disabling by gameplay code keeps working through the copy
+			Targets[Index].Value->UnRegisterTickFunction();
+			TickFunctions[Index]->RegisterTickFunction(InActor->GetLevel());
+		}
+	}
+
+	void RestoreTickFunctions()
+	{
+		AActor* InActor = Actor.Get();
+
+		for (const TUniquePtr<FViewportWidgetTimedTickFunction>& TickFunction : TickFunctions)
+		{
+			TickFunction->UnRegisterTickFunction();
+
+			// Dead owners took their tick functions with them
+			FTickFunction* Target = TickFunction->GetTarget();
+
+			if (Target && InActor && InActor->GetLevel() && !Target->IsTickFunctionRegistered())
+			{
+				Target->RegisterTickFunction(InActor->GetLevel());
+			}
+		}
+
+		TickFunctions.Reset();
+		Components.Reset();
+	}
+};
+
+static FAutoConsoleCommand MemReportCommand(
+	TEXT("ViewportWidget.MemReport"),
+	TEXT("Logs memory held by every live viewport widget and in total: UObjects, render resources, view states and render targets. Also run by memreport."),
+	FConsoleCommandWithOutputDeviceDelegate::CreateLambda([](FOutputDevice& Ar)
+		{
+			SViewportWidget::ReportMemoryUsage(Ar);
+		}));
+
+bool IsNotEqual(const TArray<FViewportWidgetEntry>& A, const TArray<FViewportWidgetEntry>& B)
+{
+	if (A.Num() != B.Num())
+	{
+		return true;
+	}
+
+	for (size_t i = 0; i < A.Num(); i++)
+	{
+		if ((A[i].ActorClassPtr != B[i].ActorClassPtr) || (GetTypeHash(A[i].SpawnTransform) != GetTypeHash(B[i].SpawnTransform)))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Copies the leader indices of entries equal by IsNotEqual, @return True if any of them changed */
+bool CopyLeaderEntryIndices(TArray<FViewportWidgetEntry>& Target, const TArray<FViewportWidgetEntry>& Source)
+{
+	bool bChanged = false;
+
+	for (int32 i = 0; i < Target.Num(); i++)
+	{
+		if (Target[i].LeaderEntryIndex != Source[i].LeaderEntryIndex)
+		{
+			Target[i].LeaderEntryIndex = Source[i].LeaderEntryIndex;
+			bChanged = true;
+		}
+	}
+
+	return bChanged;
+}
+
+FViewportWidgetPreservedState::~FViewportWidgetPreservedState()
+{
+	if (PreviewScene.IsValid())
+	{
+		PreviewScene->DissolveGCCluster();
+	}
+
+	for (FViewportWidgetEntry& Entry : Entries)
+	{
+		if (AActor* Actor = Entry.ActorObjectPtr.Get())
+		{
+			Actor->Destroy();
+
+			FViewportWidgetStats::AddSpawnedActors(-1);
+		}
+	}
+}
+
+SViewportWidget::SViewportWidget()
+	: LastTickTime(0)
+	, RenderMode(EViewportWidgetRenderMode::Realtime)
+	, ScheduledRedrawInterval(1.f)
+	, TimeSinceLastDraw(0.f)
+	, bUsePooledRenderTarget(false)
+	, LastDrawnSize(0, 0)
+	, LastTickSeconds(0.0)
+	, NumSkippedFrames(0)
+	, FirstDrawPendingTime(0.0)
+	, bPreviewSceneReady(false)
+	, bSharePoses(false)
+	, bTrackEntryCosts(false)
+{
+	static uint32 NextWidgetId = 1;
+	WidgetId = NextWidgetId++;
+
+	FViewportWidgetStats::AddLiveWidgets(1);
+}
+
+SViewportWidget::~SViewportWidget()
+{
+	EntryTickTimers.Reset();
+
+	// Close viewport
+	if (Client.IsValid())
+	{
+		Client->Viewport = NULL;
+	}
+
+	// Release our reference to the viewport client
+	Client.Reset();
+
+	ReleaseCachedRenderTarget();
+
+	CancelPendingSwap();
+
+	if (ViewportGroup.IsValid())
+	{
+		// The shared scene outlives the widget, so its actors have to go now
+		CleanEntries();
+		ViewportGroup->RemoveWidget(this);
+	}
+	else
+	{
+		// The actors go away together with the preview scene
+		FViewportWidgetStats::AddSpawnedActors(-GetNumSpawnedActors());
+	}
+
+	FViewportWidgetStats::AddLiveWidgets(-1);
+
+	check(SceneViewport.IsUnique());
+}
+
+TSharedRef<FCustomPreviewScene> SViewportWidget::MakeDefaultPreviewScene(bool stagedInitialization)
+{
+	FCustomPreviewScene::ConstructionValues CVS = CVarMinimalPreviewScenes.GetValueOnGameThread() != 0
+		? FCustomPreviewScene::ConstructionValues::Minimal()
+		: FCustomPreviewScene::ConstructionValues().SetForceMipsResident(false);
+
+	return MakeShareable(new FCustomPreviewScene(CVS
+		.SetCreateGCCluster(CVarCreateGCClusters.GetValueOnGameThread() != 0)
+		.SetStagedInitialization(stagedInitialization)), &FCustomPreviewScene::DeferredDelete);
+}
+
+void SViewportWidget::Construct(const FArguments& InArgs)
+{
+	FirstDrawPendingTime = FPlatformTime::Seconds();
+
+	RenderMode = InArgs._RenderMode;
+	ScheduledRedrawInterval = InArgs._ScheduledRedrawInterval;
+	bUsePooledRenderTarget = InArgs._UsePooledRenderTarget;
+	ViewportGroup = InArgs._ViewportGroup;
+
+	TSharedPtr<FViewportWidgetPreservedState> PreservedState = InArgs._PreservedState;
+
+	if (ViewportGroup.IsValid())
+	{
+		PreviewScene = ViewportGroup->GetPreviewScene();
+		ViewportGroup->AddWidget(this);
+	}
+	else if (PreservedState.IsValid() && PreservedState->PreviewScene.IsValid())
+	{
+		PreviewScene = PreservedState->PreviewScene;
+	}
+	else
+	{
+		const double WorldCreationStartTime = FPlatformTime::Seconds();
+
+		PreviewScene = MakeDefaultPreviewScene(InArgs._StagedInitialization);
+
+		FViewportWidgetTimings::Record(EViewportWidgetTiming::WorldCreation, (FPlatformTime::Seconds() - WorldCreationStartTime) * 1000.0, this);
+	}
+
+	bPreviewSceneReady = PreviewScene->IsReady();
+
+	ChildSlot
+		[
+			SNew(SOverlay)
+				+ SOverlay::Slot()
+				[
+					SAssignNew(ViewportWidget, SViewport)
+						.EnableGammaCorrection(false) // Scene rendering handles this
+						.RenderDirectlyToWindow(UsesCachedImage()) // Pooled and group drawing don't need a render target of its own
+						.ViewportSize(InArgs._ViewportSize)
+				]
+				+ SOverlay::Slot()
+				[
+					SAssignNew(CachedImage, SImage)
+						.Image(&CachedBrush)
+						.Visibility(UsesCachedImage() ? EVisibility::HitTestInvisible : EVisibility::Collapsed)
+				]
+				+ SOverlay::Slot()
+				[
+					SNew(SImage)
+						.Image(InArgs._PlaceholderBrush)
+						.Visibility(this, &SViewportWidget::GetPlaceholderVisibility)
+				]
+		];
+
+	// The preserved state is only of use if it lives in the same scene, e.g. not after the group changed
+	const bool bUsePreservedState = PreservedState.IsValid() && PreservedState->PreviewScene == PreviewScene;
+
+	if (bUsePreservedState && PreservedState->Client.IsValid())
+	{
+		Client = PreservedState->Client;
+		Client->SetViewportWidget(SharedThis(this));
+	}
+	else
+	{
+		Client = MakeViewportClient();
+	}
+
+	if (!Client->VisibilityDelegate.IsBound())
+	{
+		Client->VisibilityDelegate.BindSP(this, &SViewportWidget::IsVisible);
+	}
+
+	SceneViewport = MakeShareable(new FSceneViewport(Client.Get(), ViewportWidget));
+	Client->Viewport = SceneViewport.Get();
+	ViewportWidget->SetViewportInterface(SceneViewport.ToSharedRef());
+
+	Client->SetViewStateReleaseDelay(InArgs._ViewStateReleaseDelay);
+	Client->SetPostProcessLayers(InArgs._PostProcessLayers);
+
+	SetViewTransform(InArgs._ViewTransform.Get(FTransform::Identity));
+
+	SetLayout(InArgs._Layout);
+	SetPanes(InArgs._Panes);
+
+	Client->SetShowStatsOverlay(InArgs._ShowStatsOverlay);
+
+	bSharePoses = InArgs._SharePoses;
+
+	if (bUsePreservedState)
+	{
+		// Spawned actors are taken over, SetEntries below only touches them if the entries differ
+		Entries = MoveTemp(PreservedState->Entries);
+		RequestRedraw();
+	}
+
+	SetEntries(const_cast<TArray<FViewportWidgetEntry>&>(InArgs._Entries.Get()));
+
+	// Taken over actors may have followed other leaders
+	ApplyPoseSharing();
+}
+
+TSharedRef<FViewportWidgetPreservedState> SViewportWidget::DetachPreservedState()
+{
+	CancelPendingSwap();
+
+	// The next widget doesn't know they wait for their PSOs
+	for (const TPair<TWeakObjectPtr<AActor>, double>& Pending : PSOPrecachingActors)
+	{
+		if (AActor* actor = Pending.Key.Get())
+		{
+			FCustomPreviewScene::SetActorHiddenInPreview(actor, false);
+		}
+	}
+
+	PSOPrecachingActors.Reset();
+
+	// Entries tick on their own again, the next widget times them if it tracks entry costs
+	EntryTickTimers.Reset();
+
+	TSharedRef<FViewportWidgetPreservedState> PreservedState = MakeShared<FViewportWidgetPreservedState>();
+
+	if (Client.IsValid())
+	{
+		SceneViewport->SetViewportClient(nullptr);
+
+		Client->Viewport = nullptr;
+		Client->VisibilityDelegate.Unbind();
+		Client->SetViewportWidget(nullptr);
+	}
+
+	PreservedState->PreviewScene = MoveTemp(PreviewScene);
+	PreservedState->Client = MoveTemp(Client);
+
+	if (Entries.IsSet())
+	{
+		PreservedState->Entries = Entries.Get();
+		Entries = TArray<FViewportWidgetEntry>();
+	}
+
+	if (ViewportGroup.IsValid())
+	{
+		ViewportGroup->RemoveWidget(this);
+		ViewportGroup.Reset();
+	}
+
+	ReleaseCachedRenderTarget();
+
+	return PreservedState;
+}
+
+void SViewportWidget::SetViewTransform(const FTransform& viewTransform)
+{
+	if (!ViewTransform.IsSet() || GetTypeHash(ViewTransform.Get()) != GetTypeHash(viewTransform))
+	{
+		ViewTransform = viewTransform;
+
+		Client->SetViewLocation(viewTransform.GetLocation());
+		Client->SetViewRotation(viewTransform.Rotator());
+
+		RequestRedraw();
+	}
+}
+
+void SViewportWidget::SetEntries(TArray<FViewportWidgetEntry>& entries)
+{
+	if (PendingSwap.IsValid() && !PendingSwap->bSwapped && !IsNotEqual(PendingSwap->Entries, entries))
+	{
+		// Already being swapped in, pose sharing is applied once swapped
+		CopyLeaderEntryIndices(PendingSwap->Entries, entries);
+		return;
+	}
+
+	CancelPendingSwap();
+
+	DropPrefetch(entries);
+
+	if (!Entries.IsSet() || IsNotEqual(Entries.Get(), entries))
+	{
+		if (FirstDrawPendingTime == 0.0)
+		{
+			FirstDrawPendingTime = FPlatformTime::Seconds();
+		}
+
+		CleanEntries();
+		Entries = entries;
+		AddEntries();
+
+		// Spawned actors may bring post process volumes along
+		Client->InvalidateCachedViewSetup();
+
+		RequestRedraw();
+	}
+	else
+	{
+		UpdateEntryLeaders(entries);
+	}
+}
+
+void SViewportWidget::UpdateEntryLeaders(const TArray<FViewportWidgetEntry>& entries)
+{
+	TArray<FViewportWidgetEntry> updatedEntries = Entries.Get();
+
+	if (CopyLeaderEntryIndices(updatedEntries, entries))
+	{
+		// Spawned actors are kept, only their leader pose components change
+		Entries = updatedEntries;
+
+		ApplyPoseSharing();
+
+		RequestRedraw();
+	}
+}
+
+void SViewportWidget::SetRenderMode(EViewportWidgetRenderMode renderMode, float scheduledRedrawInterval)
+{
+	ScheduledRedrawInterval = scheduledRedrawInterval;
+
+	if (RenderMode != renderMode)
+	{
+		const bool bUsedCachedImage = UsesCachedImage();
+
+		RenderMode = renderMode;
+
+		if (bUsedCachedImage != UsesCachedImage())
+		{
+			ReleaseCachedRenderTarget();
+			UpdateViewportTarget();
+		}
+
+		RequestRedraw();
+	}
+}
+
+void SViewportWidget::SetViewportGroup(const TSharedPtr<FCustomViewportGroup>& viewportGroup)
+{
+	if (ViewportGroup == viewportGroup)
+	{
+		return;
+	}
+
+	if (ViewportGroup.IsValid())
+	{
+		ViewportGroup->RemoveWidget(this);
+	}
+
+	TSharedPtr<FCustomPreviewScene> NewPreviewScene = viewportGroup.IsValid() ? viewportGroup->GetPreviewScene() : MakeDefaultPreviewScene();
+
+	if (NewPreviewScene != PreviewScene)
+	{
+		CancelPendingSwap();
+		CleanEntries();
+
+		// Keep the old scene alive until the client released the view states rendered with it
+		TSharedPtr<FCustomPreviewScene> OldPreviewScene = PreviewScene;
+		PreviewScene = NewPreviewScene;
+		Client->SetPreviewScene(PreviewScene.Get());
+		OldPreviewScene.Reset();
+
+		bPreviewSceneReady = PreviewScene->IsReady();
+
+		AddEntries();
+	}
+
+	ViewportGroup = viewportGroup;
+
+	if (ViewportGroup.IsValid())
+	{
+		ViewportGroup->AddWidget(this);
+	}
+
+	ReleaseCachedRenderTarget();
+	UpdateViewportTarget();
+
+	RequestRedraw();
+}
+
+void SViewportWidget::UpdateViewportTarget()
+{
+	if (!ViewportWidget.IsValid() || !SceneViewport.IsValid())
+	{
+		return;
+	}
+
+	ViewportWidget->SetRenderDirectlyToWindow(UsesCachedImage());
+	CachedImage->SetVisibility(UsesCachedImage() ? EVisibility::HitTestInvisible : EVisibility::Collapsed);
+	CachedBrush.SetUVRegion(FBox2f(ForceInit));
+
+	// Allocates or frees the render target of the viewport itself
+	const FIntPoint Size = SceneViewport->GetSizeXY();
+	if (Size.X > 0 && Size.Y > 0)
+	{
+		SceneViewport->UpdateViewportRHI(false, Size.X, Size.Y, EWindowMode::Windowed, PF_Unknown);
+	}
+}
+
+void SViewportWidget::SetPostProcessLayers(const TSharedPtr<const FCustomViewportPostProcessLayers>& postProcessLayers)
+{
+	if (Client.IsValid() && Client->GetPostProcessLayers() != postProcessLayers)
+	{
+		Client->SetPostProcessLayers(postProcessLayers);
+
+		RequestRedraw();
+	}
+}
+
+void SViewportWidget::SetLayout(EViewportWidgetLayout layout)
+{
+	if (Client->GetNumPanes() != GetViewportWidgetLayoutNumPanes(layout))
+	{
+		Client->SetNumPanes(GetViewportWidgetLayoutNumPanes(layout));
+
+		RequestRedraw();
+	}
+}
+
+void SViewportWidget::SetPanes(const TArray<FViewportWidgetPane>& panes)
+{
+	// Panes without a view keep the defaults of the layout
+	for (int32 PaneIndex = 1; PaneIndex < Client->GetNumPanes() && panes.IsValidIndex(PaneIndex - 1); ++PaneIndex)
+	{
+		const FViewportWidgetPane& Pane = panes[PaneIndex - 1];
+		Client->SetPaneView(PaneIndex, Pane.ViewportType, Pane.ViewTransform.GetLocation(), Pane.ViewTransform.Rotator());
+	}
+
+	RequestRedraw();
+}
+
+void SViewportWidget::SetSharePoses(bool sharePoses)
+{
+	if (bSharePoses != sharePoses)
+	{
+		bSharePoses = sharePoses;
+
+		ApplyPoseSharing();
+	}
+}
+
+void SViewportWidget::ApplyPoseSharing()
+{
+	if (!Entries.IsSet())
+	{
+		return;
+	}
+
+	const TArray<FViewportWidgetEntry>& entries = Entries.Get();
+
+	auto FindSkeletalMesh = [&entries](int32 entryIndex) -> USkeletalMeshComponent*
+		{
+			AActor* actor = entries[entryIndex].ActorObjectPtr.Get();
+			return actor ? actor->FindComponentByClass<USkeletalMeshComponent>() : nullptr;
+		};
+
+	// Leader of every entry, explicit ones first, then the first entry of each class and anim instance
+	TArray<int32> LeaderIndices;
+	LeaderIndices.Init(INDEX_NONE, entries.Num());
+
+	TMap<TPair<UClass*, UClass*>, int32> AutoLeaderIndices;
+
+	for (int32 entryIndex = 0; entryIndex < entries.Num(); ++entryIndex)
+	{
+		const int32 leaderIndex = entries[entryIndex].LeaderEntryIndex;
+
+		if (leaderIndex != INDEX_NONE)
+		{
+			LeaderIndices[entryIndex] = entries.IsValidIndex(leaderIndex) && leaderIndex != entryIndex ? leaderIndex : INDEX_NONE;
+		}
+		else if (bSharePoses)
+		{
+			if (USkeletalMeshComponent* SkeletalMesh = FindSkeletalMesh(entryIndex))
+			{
+				const TPair<UClass*, UClass*> Key(SkeletalMesh->GetOwner()->GetClass(), SkeletalMesh->GetAnimClass());
+
+				if (const int32* AutoLeaderIndex = AutoLeaderIndices.Find(Key))
+				{
+					LeaderIndices[entryIndex] = *AutoLeaderIndex;
+				}
+				else
+				{
+					AutoLeaderIndices.Add(Key, entryIndex);
+				}
+			}
+		}
+	}
+
+	for (int32 entryIndex = 0; entryIndex < entries.Num(); ++entryIndex)
+	{
+		USkeletalMeshComponent* Follower = FindSkeletalMesh(entryIndex);
+
+		if (!Follower)
+		{
+			continue;
+		}
+
+		// Leaders following someone else hand their followers on, cycles evaluate on their own
+		int32 leaderIndex = LeaderIndices[entryIndex];
+
+		for (int32 Step = 0; leaderIndex != INDEX_NONE && LeaderIndices[leaderIndex] != INDEX_NONE; ++Step)
+		{
+			leaderIndex = Step < entries.Num() ? LeaderIndices[leaderIndex] : INDEX_NONE;
+		}
+
+		USkeletalMeshComponent* Leader = leaderIndex != INDEX_NONE && leaderIndex != entryIndex ? FindSkeletalMesh(leaderIndex) : nullptr;
+
+		if (Follower->LeaderPoseComponent.Get() != Leader)
+		{
+			// Followers skip their anim graph and use the leader's bone transforms
+			Follower->SetLeaderPoseComponent(Leader);
+		}
+	}
+}
+
+void SViewportWidget::SetShowStatsOverlay(bool showStatsOverlay)
+{
+	Client->SetShowStatsOverlay(showStatsOverlay);
+
+	RequestRedraw();
+}
+
+void SViewportWidget::RequestRedraw()
+{
+	if (Client.IsValid())
+	{
+		Client->bNeedsRedraw = true;
+	}
+}
+
+void SViewportWidget::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	VIEWPORTWIDGET_SCOPE(Tick);
+
+	LastTickTime = FPlatformTime::Seconds();
+
+	ON_SCOPE_EXIT
+	{
+		LastTickSeconds = FPlatformTime::Seconds() - LastTickTime;
+	};
+
+	if (PreviewScene.IsValid() && !PreviewScene->IsReady())
+	{
+		if (!PreviewScene->AdvanceInitialization())
+		{
+			return;
+		}
+
+		OnPreviewSceneReady();
+	}
+	else if (!bPreviewSceneReady && PreviewScene.IsValid())
+	{
+		// Another member of the group finished the shared scene
+		OnPreviewSceneReady();
+	}
+
+	TickPSOPrecachingActors();
+
+	TickPendingSwap();
+
+	TickPrefetches();
+
+	UpdateEntryTickTimers();
+
+	if (ViewportGroup.IsValid())
+	{
+		ViewportGroup->Tick(InDeltaTime);
+	}
+	else if (PreviewScene.IsValid())
+	{
+		PreviewScene->UpdateCaptureContents();
+		PreviewScene->ClearLineBatcher();
+		PreviewScene->TickTexturePriming();
+	}
+
+	if (Client.IsValid())
+	{
+		if (!ViewportGroup.IsValid())
+		{
+			VIEWPORTWIDGET_SCOPE(WorldTick);
+
+			Client->GetWorld()->Tick(ELevelTick::LEVELTICK_All, InDeltaTime);
+		}
+
+		for (const TUniquePtr<FViewportWidgetEntryTickTimer>& EntryTickTimer : EntryTickTimers)
+		{
+			EntryTickTimer->OnWorldTicked();
+		}
+
+		{
+			VIEWPORTWIDGET_SCOPE(ClientTick);
+
+			FScopedConditionalWorldSwitcher WorldSwitcher(Client->GetWorld());
+
+			Client->Tick(InDeltaTime);
+		}
+
+		if (ShouldDraw(InDeltaTime))
+		{
+			AddStreamingViewInformation();
+
+			Draw();
+		}
+		else
+		{
+			NumSkippedFrames++;
+		}
+	}
+}
+
+bool SViewportWidget::ShouldDraw(float DeltaTime)
+{
+	TimeSinceLastDraw += DeltaTime;
+
+	if (RenderMode == EViewportWidgetRenderMode::Realtime || Client->bNeedsRedraw || SceneViewport->GetSizeXY() != LastDrawnSize)
+	{
+		return true;
+	}
+
+	return RenderMode == EViewportWidgetRenderMode::Scheduled && TimeSinceLastDraw >= ScheduledRedrawInterval;
+}
+
+void SViewportWidget::Draw()
+{
+	if (ViewportGroup.IsValid())
+	{
+		// The group draws every visible member at once and calls OnDrawnInGroup back
+		ViewportGroup->Draw();
+		return;
+	}
+
+	if (UsesPooledRenderTarget())
+	{
+		DrawToPooledRenderTarget();
+	}
+	else
+	{
+		Client->Viewport->Draw();
+	}
+
+	Client->bNeedsRedraw = false;
+	TimeSinceLastDraw = 0.f;
+	LastDrawnSize = SceneViewport->GetSizeXY();
+
+	InvalidateAfterDraw(false);
+
+	RecordFirstDraw();
+
+	OnSwapDrawn();
+}
+
+void SViewportWidget::DrawToPooledRenderTarget()
+{
+	VIEWPORTWIDGET_SCOPE(DrawPooled);
+
+	const FIntPoint Size = SceneViewport->GetSizeXY();
+	UWorld* World = Client->GetWorld();
+
+	if (Size.X <= 0 || Size.Y <= 0 || !World)
+	{
+		return;
+	}
+
+	// The kept copy has the pooled target's format, so HDR previews aren't clamped to 8 bit
+	const EPixelFormat Format = SceneViewport->IsHDRViewport() ? PF_FloatRGBA : PF_B8G8R8A8;
+
+	if (!CachedRenderTarget.IsValid() || CachedRenderTarget->SizeX != Size.X || CachedRenderTarget->SizeY != Size.Y || CachedRenderTarget->GetFormat() != Format)
+	{
+		ReleaseCachedRenderTarget();
+
+		CachedRenderTarget.Reset(FViewportRenderTargetPool::Get().CreateCachedCopy(Size, Format));
+
+		CachedBrush.SetResourceObject(CachedRenderTarget.Get());
+		CachedBrush.ImageSize = FVector2D(Size);
+
+		InvalidateAfterDraw(true);
+	}
+
+	FViewportRenderTargetPool& Pool = FViewportRenderTargetPool::Get();
+	UTextureRenderTarget2D* PooledRenderTarget = Pool.Acquire(Size, Format);
+
+	{
+		FCanvas Canvas(PooledRenderTarget->GameThread_GetRenderTargetResource(), nullptr, World, World->GetFeatureLevel());
+		Client->Draw(SceneViewport.Get(), &Canvas);
+		Canvas.Flush_GameThread();
+	}
+
+	// Keep only the final color, the pooled target goes back to be reused by other widgets
+	{
+		FCanvas Canvas(CachedRenderTarget->GameThread_GetRenderTargetResource(), nullptr, World, World->GetFeatureLevel());
+		Canvas.DrawTile(0, 0, Size.X, Size.Y, 0, 0, 1, 1, FLinearColor::White, PooledRenderTarget->GetResource(), false);
+		Canvas.Flush_GameThread();
+	}
+
+	Pool.Release(PooledRenderTarget);
+}
+
+void SViewportWidget::OnDrawnInGroup(UTextureRenderTarget2D* RenderTarget, const FIntRect& Region)
+{
+	const FVector2f RenderTargetSize(RenderTarget->SizeX, RenderTarget->SizeY);
+	const FBox2f UVRegion(FVector2f(Region.Min) / RenderTargetSize, FVector2f(Region.Max) / RenderTargetSize);
+
+	const bool bBrushChanged = CachedBrush.GetResourceObject() != RenderTarget || CachedBrush.GetUVRegion() != UVRegion || CachedBrush.ImageSize != FVector2D(Region.Size());
+
+	CachedBrush.SetResourceObject(RenderTarget);
+	CachedBrush.SetUVRegion(UVRegion);
+	CachedBrush.ImageSize = FVector2D(Region.Size());
+
+	Client->bNeedsRedraw = false;
+	TimeSinceLastDraw = 0.f;
+	LastDrawnSize = Region.Size();
+
+	InvalidateAfterDraw(bBrushChanged);
+
+	RecordFirstDraw();
+
+	OnSwapDrawn();
+}
+
+void SViewportWidget::InvalidateAfterDraw(bool brushChanged)
+{
+	// Cached paint samples the render target, so new content shows up without repainting, except in hosts caching pixels
+	// like retainer boxes. On demand widgets are meant to leave those caches alone, only a changed brush must be repainted.
+	if (brushChanged || RenderMode != EViewportWidgetRenderMode::OnDemand)
+	{
+		Invalidate(EInvalidateWidgetReason::Paint);
+	}
+}
+
+EVisibility SViewportWidget::GetPlaceholderVisibility() const
+{
+	return bPreviewSceneReady ? EVisibility::Collapsed : EVisibility::HitTestInvisible;
+}
+
+void SViewportWidget::OnPreviewSceneReady()
+{
+	bPreviewSceneReady = true;
+
+	// The placeholder goes away
+	Invalidate(EInvalidateWidgetReason::Visibility);
+
+	// Entries set while the world was initializing were kept but not spawned
+	AddEntries();
+
+	Client->InvalidateCachedViewSetup();
+
+	RequestRedraw();
+}
+
+void SViewportWidget::AddStreamingViewInformation()
+{
+	const float ScreenSize = GetStreamingScreenSize();
+
+	if (ScreenSize <= 0.f || !IStreamingManager::Get().IsTextureStreamingEnabled())
+	{
+		return;
+	}
+
+	// Lets the streamer pick mips for the widget's pixel size, it only knows the game and editor views otherwise.
+	// The streamer doesn't tell worlds apart, textures of the game world near the preview camera's location are streamed for this view too,
+	// so it is only added on frames the preview is drawn
+	const float FOVScreenSize = ScreenSize / FMath::Tan(FMath::DegreesToRadians(Client->ViewFOV * 0.5f));
+
+	IStreamingManager::Get().AddViewInformation(Client->GetViewLocation(), ScreenSize, FOVScreenSize);
+}
+
+float SViewportWidget::GetStreamingScreenSize() const
+{
+	return SceneViewport.IsValid() ? (float)SceneViewport->GetSizeXY().X : 0.f;
+}
+
+void SViewportWidget::RecordFirstDraw()
+{
+	if (FirstDrawPendingTime > 0.0)
+	{
+		FViewportWidgetTimings::Record(EViewportWidgetTiming::FirstDraw, (FPlatformTime::Seconds() - FirstDrawPendingTime) * 1000.0, this);
+
+		FirstDrawPendingTime = 0.0;
+	}
+}
+
+void SViewportWidget::ReleaseCachedRenderTarget()
+{
+	if (CachedRenderTarget.IsValid())
+	{
+		FViewportRenderTargetPool::Get().ReleaseCachedCopy(CachedRenderTarget.Get());
+		CachedRenderTarget.Reset();
+	}
+
+	CachedBrush.SetResourceObject(nullptr);
+}
+
+bool SViewportWidget::IsVisible() const
+{
+#if WITH_DUMPGPU
+	extern ENGINE_API uint32 GDumpGPU_FrameNumber;
+#endif
+
+	const float VisibilityTimeThreshold = .25f;
+	// The viewport is visible if we don't have a parent layout (likely a floating window) or this viewport is visible in the parent layout.
+	// Also, always render the viewport if DumpGPU is active, regardless of tick time threshold -- otherwise these don't show up due to lag
+	// caused by the GPU dump being triggered.
+	return
+		ViewportWidget.IsValid() &&
+		LastTickTime == 0.0 ||	// Never been ticked
+		FPlatformTime::Seconds() - LastTickTime <= VisibilityTimeThreshold	// Ticked recently
+#if WITH_DUMPGPU
+		|| GDumpGPU_FrameNumber == GFrameNumber	// GPU dump in progress
+#endif		
+		;
+}
+
+TWeakObjectPtr<AActor> SViewportWidget::GetSpawnedActor(const int32 entryIndex) const
+{
+	if (Entries.IsSet())
+	{
+		if (Entries.Get().IsValidIndex(entryIndex))
+		{
+			return Entries.Get()[entryIndex].ActorObjectPtr;
+		}
+	}
+
+	return TWeakObjectPtr<AActor>();
+}
+
+int32 SViewportWidget::GetNumSpawnedActors() const
+{
+	int32 NumSpawnedActors = 0;
+
+	if (Entries.IsSet())
+	{
+		for (const FViewportWidgetEntry& ViewportWidgetEntry : Entries.Get())
+		{
+			NumSpawnedActors += ViewportWidgetEntry.ActorObjectPtr.IsValid() ? 1 : 0;
+		}
+	}
+
+	return NumSpawnedActors;
+}
+
+TArray<FViewportWidgetEntryCost> SViewportWidget::GetEntryCosts() const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(SViewportWidget::GetEntryCosts);
+
+	TArray<FViewportWidgetEntryCost> EntryCosts;
+
+	if (!Entries.IsSet() || !Client.IsValid())
+	{
+		return EntryCosts;
+	}
+
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Get().Num(); ++EntryIndex)
+	{
+		const FViewportWidgetEntry& ViewportWidgetEntry = Entries.Get()[EntryIndex];
+		AActor* actor = ViewportWidgetEntry.ActorObjectPtr.Get();
+
+		if (!actor)
+		{
+			continue;
+		}
+
+		FViewportWidgetEntryCost& EntryCost = EntryCosts.AddDefaulted_GetRef();
+		EntryCost.EntryIndex = EntryIndex;
+		EntryCost.ActorClassPtr = ViewportWidgetEntry.ActorClassPtr;
+		EntryCost.NumEntries = 1;
+
+		TInlineComponentArray<UActorComponent*> Components(actor);
+		EntryCost.NumComponents = Components.Num();
+
+		if (const TUniquePtr<FViewportWidgetEntryTickTimer>* EntryTickTimer = EntryTickTimers.FindByPredicate([actor](const TUniquePtr<FViewportWidgetEntryTickTimer>& Timer) { return Timer->Actor.Get() == actor; }))
+		{
+			EntryCost.TickMs = (*EntryTickTimer)->GetAverageTickMs();
+		}
+
+		for (UActorComponent* Component : Components)
+		{
+			UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component);
+
+			if (!Primitive || !Primitive->IsRegistered())
+			{
+				continue;
+			}
+
+			EntryCost.NumPrimitives++;
+
+			if (Primitive->IsVisible())
+			{
+				EntryCost.EstimatedDrawCalls += Primitive->GetNumMaterials() * (Primitive->CastShadow ? 2 : 1);
+			}
+
+			if (UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(Primitive))
+			{
+				if (StaticMeshComponent->GetStaticMesh() && StaticMeshComponent->IsVisible())
+				{
+					EntryCost.NumTriangles += StaticMeshComponent->GetStaticMesh()->GetNumTriangles(0);
+				}
+			}
+			else if (USkeletalMeshComponent* SkeletalMeshComponent = Cast<USkeletalMeshComponent>(Primitive))
+			{
+				EntryCost.NumBones += SkeletalMeshComponent->GetNumBones();
+
+				const FSkeletalMeshRenderData* RenderData = SkeletalMeshComponent->GetSkinnedAsset() ? SkeletalMeshComponent->GetSkinnedAsset()->GetResourceForRendering() : nullptr;
+				if (RenderData && RenderData->LODRenderData.Num() > 0 && SkeletalMeshComponent->IsVisible())
+				{
+					EntryCost.NumTriangles += RenderData->LODRenderData[0].GetTotalFaces();
+				}
+			}
+		}
+	}
+
+	return EntryCosts;
+}
+
+void SViewportWidget::SetTrackEntryCosts(bool trackEntryCosts)
+{
+	bTrackEntryCosts = trackEntryCosts;
+}
+
+void SViewportWidget::UpdateEntryTickTimers()
+{
+	if (!bTrackEntryCosts && CVarTrackEntryCosts.GetValueOnGameThread() == 0)
+	{
+		EntryTickTimers.Reset();
+		return;
+	}
+
+	if (!Entries.IsSet() || !bPreviewSceneReady)
+	{
+		return;
+	}
+
+	// Timers of actors that aren't entries anymore, e.g. destroyed by gameplay code
+	EntryTickTimers.RemoveAllSwap([this](const TUniquePtr<FViewportWidgetEntryTickTimer>& EntryTickTimer)
+		{
+			return !Entries.Get().ContainsByPredicate([&EntryTickTimer](const FViewportWidgetEntry& Entry) { return Entry.ActorObjectPtr.IsValid() && Entry.ActorObjectPtr == EntryTickTimer->Actor; });
+		});
+
+	for (const TUniquePtr<FViewportWidgetEntryTickTimer>& EntryTickTimer : EntryTickTimers)
+	{
+		if (EntryTickTimer->NeedsRebuild())
+		{
+			EntryTickTimer->Rebuild();
+		}
+	}
+
+	for (const FViewportWidgetEntry& Entry : Entries.Get())
+	{
+		AActor* actor = Entry.ActorObjectPtr.Get();
+
+		if (actor && !EntryTickTimers.ContainsByPredicate([actor](const TUniquePtr<FViewportWidgetEntryTickTimer>& EntryTickTimer) { return EntryTickTimer->Actor.Get() == actor; }))
+		{
+			EntryTickTimers.Add(MakeUnique<FViewportWidgetEntryTickTimer>(actor));
+		}
+	}
+}
+
+void FViewportWidgetEntryCost::Accumulate(const FViewportWidgetEntryCost& Other)
+{
+	NumEntries += Other.NumEntries;
+	TickMs += Other.TickMs;
+	NumComponents += Other.NumComponents;
+	NumPrimitives += Other.NumPrimitives;
+	NumBones += Other.NumBones;
+	EstimatedDrawCalls += Other.EstimatedDrawCalls;
+	NumTriangles += Other.NumTriangles;
+}
+
+TArray<FViewportWidgetEntryCost> SViewportWidget::AggregateCostsByClass(const TArray<FViewportWidgetEntryCost>& EntryCosts)
+{
+	TArray<FViewportWidgetEntryCost> ClassCosts;
+
+	for (const FViewportWidgetEntryCost& EntryCost : EntryCosts)
+	{
+		FViewportWidgetEntryCost* ClassCost = ClassCosts.FindByPredicate([&EntryCost](const FViewportWidgetEntryCost& Cost) { return Cost.ActorClassPtr == EntryCost.ActorClassPtr; });
+
+		if (!ClassCost)
+		{
+			ClassCost = &ClassCosts.AddDefaulted_GetRef();
+			ClassCost->ActorClassPtr = EntryCost.ActorClassPtr;
+		}
+
+		ClassCost->Accumulate(EntryCost);
+	}
+
+	ClassCosts.Sort([](const FViewportWidgetEntryCost& A, const FViewportWidgetEntryCost& B) { return A.TickMs > B.TickMs; });
+
+	return ClassCosts;
+}
+
+void SViewportWidget::LogEntryCosts() const
+{
+	const TArray<FViewportWidgetEntryCost> EntryCosts = GetEntryCosts();
+
+	auto LogCost = [](const TCHAR* Label, const FViewportWidgetEntryCost& Cost)
+		{
+			UE_LOG(LogViewportWidget, Display, TEXT("  %s %s: %d entries, tick %.3f ms, %d components, %d primitives, %d bones, ~%d draw calls, %d triangles"),
+				Label, *Cost.ActorClassPtr.GetAssetName(), Cost.NumEntries, Cost.TickMs, Cost.NumComponents, Cost.NumPrimitives, Cost.NumBones, Cost.EstimatedDrawCalls, Cost.NumTriangles);
+		};
+
+	UE_LOG(LogViewportWidget, Display, TEXT("Viewport widget #%u entry costs:"), WidgetId);
+
+	for (const FViewportWidgetEntryCost& EntryCost : EntryCosts)
+	{
+		LogCost(*FString::Printf(TEXT("Entry %d"), EntryCost.EntryIndex), EntryCost);
+	}
+
+	for (const FViewportWidgetEntryCost& ClassCost : AggregateCostsByClass(EntryCosts))
+	{
+		LogCost(TEXT("Class"), ClassCost);
+	}
+}
+
+FViewportWidgetMemoryUsage SViewportWidget::GetMemoryUsage(bool includeScene) const
+{
+	FViewportWidgetMemoryUsage MemoryUsage;
+
+	if (includeScene && PreviewScene)
+	{
+		MemoryUsage = PreviewScene->GetMemoryUsage();
+	}
+
+	if (Client)
+	{
+		MemoryUsage.ViewStateBytes = Client->GetViewStateSizeBytes();
+	}
+
+	if (SceneViewport && !UsesCachedImage())
+	{
+		if (const FTexture2DRHIRef& ViewportTexture = SceneViewport->GetRenderTargetTexture())
+		{
+			MemoryUsage.RenderTargetBytes += CalcTextureSize(ViewportTexture->GetSizeX(), ViewportTexture->GetSizeY(), ViewportTexture->GetFormat(), ViewportTexture->GetNumMips());
+		}
+	}
+
+	MemoryUsage.RenderTargetBytes += FViewportRenderTargetPool::CalcRenderTargetBytes(CachedRenderTarget.Get());
+
+	return MemoryUsage;
+}
+
+FViewportWidgetMemoryUsage SViewportWidget::GetTotalMemoryUsage()
+{
+	FViewportWidgetMemoryUsage TotalUsage;
+
+	TSet<const FCustomPreviewScene*> CountedScenes;
+	TSet<const FCustomViewportGroup*> CountedGroups;
+
+	for (FCustomViewportClient* Client : FCustomViewportClient::GetLiveClients())
+	{
+		if (TSharedPtr<SViewportWidget> Widget = Client->GetViewportWidget())
+		{
+			bool bSceneAlreadyCounted = false;
+			CountedScenes.Add(Widget->PreviewScene.Get(), &bSceneAlreadyCounted);
+
+			TotalUsage += Widget->GetMemoryUsage(!bSceneAlreadyCounted);
+
+			bool bGroupAlreadyCounted = true;
+
+			if (Widget->ViewportGroup)
+			{
+				CountedGroups.Add(Widget->ViewportGroup.Get(), &bGroupAlreadyCounted);
+			}
+
+			if (!bGroupAlreadyCounted)
+			{
+				TotalUsage.RenderTargetBytes += Widget->ViewportGroup->GetRenderTargetBytes();
+			}
+		}
+	}
+
+	TotalUsage.RenderTargetBytes += FViewportRenderTargetPool::Get().GetPoolBytes();
+
+	return TotalUsage;
+}
+
+void SViewportWidget::ReportMemoryUsage(FOutputDevice& Ar)
+{
+	VIEWPORTWIDGET_SCOPE(MemReport);
+
+	auto LogUsage = [&Ar](const TCHAR* Label, const FViewportWidgetMemoryUsage& MemoryUsage)
+		{
+			Ar.Logf(TEXT("%s: %.2f MB total, %.2f MB UObjects (%d objects), %.2f MB render resources, %.2f MB view states, %.2f MB render targets"),
+				Label, MemoryUsage.GetTotalBytes() / 1024.f / 1024.f, MemoryUsage.UObjectBytes / 1024.f / 1024.f, MemoryUsage.NumObjects, MemoryUsage.RenderResourceBytes / 1024.f / 1024.f,
+				MemoryUsage.ViewStateBytes / 1024.f / 1024.f, MemoryUsage.RenderTargetBytes / 1024.f / 1024.f);
+		};
+
+	Ar.Logf(TEXT("Viewport widget memory:"));
+
+	const TArray<FCustomViewportClient*>& Clients = FCustomViewportClient::GetLiveClients();
+
+	for (int32 ClientIndex = 0; ClientIndex < Clients.Num(); ++ClientIndex)
+	{
+		if (TSharedPtr<SViewportWidget> Widget = Clients[ClientIndex]->GetViewportWidget())
+		{
+			LogUsage(*FString::Printf(TEXT("  Widget #%u%s"), Widget->GetWidgetId(), Widget->ViewportGroup ? TEXT(" (shared scene)") : TEXT("")), Widget->GetMemoryUsage());
+
+			if (Widget->PreviewScene.IsValid())
+			{
+				const FCustomPreviewScene::FTextureStreamingStats StreamingStats = Widget->PreviewScene->GetTextureStreamingStats();
+
+				Ar.Logf(TEXT("    Textures: %.2f MB resident, %d priming (%.2f MB of %.2f MB budget), %d over budget"),
+					StreamingStats.ResidentBytes / 1024.f / 1024.f, StreamingStats.NumPrimingTextures, StreamingStats.PrimingBytes / 1024.f / 1024.f,
+					CVarTexturePrimeBudget.GetValueOnGameThread(), StreamingStats.NumOverBudget);
+			}
+		}
+	}
+
+	const FViewportRenderTargetPool& RenderTargetPool = FViewportRenderTargetPool::Get();
+	Ar.Logf(TEXT("  Render target pool: %.2f MB pooled, %.2f MB cached copies"), RenderTargetPool.GetPoolBytes() / 1024.f / 1024.f, RenderTargetPool.GetCachedCopyBytes() / 1024.f / 1024.f);
+
+	for (const TPair<EPixelFormat, SIZE_T>& Pair : RenderTargetPool.GetCachedCopyBytesByFormat())
+	{
+		Ar.Logf(TEXT("    %s cached copies: %.2f MB"), GetPixelFormatString(Pair.Key), Pair.Value / 1024.f / 1024.f);
+	}
+
+	const FViewportWidgetMemoryUsage TotalUsage = GetTotalMemoryUsage();
+	LogUsage(TEXT("Total"), TotalUsage);
+
+	const float BudgetMB = CVarMemoryBudget.GetValueOnGameThread();
+
+	if (BudgetMB > 0.f)
+	{
+		Ar.Logf(TEXT("Budget: %.2f MB, %s"), BudgetMB, TotalUsage.GetTotalBytes() > BudgetMB * 1024.f * 1024.f ? TEXT("EXCEEDED") : TEXT("ok"));
+	}
+}
+
+TSharedRef<FCustomViewportClient> SViewportWidget::MakeViewportClient()
+{
+	TSharedPtr<FCustomViewportClient> client = MakeShareable(new FCustomViewportClient(PreviewScene.Get(), SharedThis(this)));
+
+	client->SetRealtime(true);
+	client->VisibilityDelegate.BindSP(this, &SViewportWidget::IsVisible);
+
+	return client.ToSharedRef();
+}
+
+void SViewportWidget::CleanEntries()
+{
+	VIEWPORTWIDGET_SCOPE(CleanEntries);
+
+	if (UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr)
+	{
+		PreviewScene->DissolveGCCluster();
+
+		if (Entries.IsSet())
+		{
+			for (FViewportWidgetEntry& ViewportWidgetEntry : const_cast<TArray<FViewportWidgetEntry>&>(Entries.Get()))
+			{
+				if (AActor* actor = ViewportWidgetEntry.ActorObjectPtr.Get())
+				{
+					world->DestroyActor(actor);
+
+					FViewportWidgetStats::AddSpawnedActors(-1);
+				}
+
+				ViewportWidgetEntry.ActorObjectPtr.Reset();
+			}
+		}
+	}
+}
+
+void SViewportWidget::AddEntries()
+{
+	VIEWPORTWIDGET_SCOPE(AddEntries);
+
+	if (UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr)
+	{
+		if (Entries.IsSet())
+		{
+			TArray<FViewportWidgetEntry>& entries = const_cast<TArray<FViewportWidgetEntry>&>(Entries.Get());
+
+			for (int32 entryIndex = 0; entryIndex < entries.Num(); ++entryIndex)
+			{
+				entries[entryIndex].ActorObjectPtr = SpawnEntryActor(entries[entryIndex], entryIndex);
+			}
+		}
+
+		ApplyPoseSharing();
+
+		PreviewScene->CreateGCCluster();
+	}
+}
+
+AActor* SViewportWidget::SpawnEntryActor(const FViewportWidgetEntry& ViewportWidgetEntry, int32 entryIndex)
+{
+	UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr;
+
+	if (!world)
+	{
+		return nullptr;
+	}
+
+	TSubclassOf<AActor> actorClass = ViewportWidgetEntry.ActorClassPtr.Get();
+
+	if (!actorClass && !ViewportWidgetEntry.ActorClassPtr.IsNull())
+	{
+		const double LoadStartTime = FPlatformTime::Seconds();
+
+		actorClass = ViewportWidgetEntry.ActorClassPtr.LoadSynchronous();
+
+		FViewportWidgetTimings::Record(EViewportWidgetTiming::ClassLoad, (FPlatformTime::Seconds() - LoadStartTime) * 1000.0, this, entryIndex, actorClass);
+	}
+
+	if (!actorClass)
+	{
+		return nullptr;
+	}
+
+	const double SpawnStartTime = FPlatformTime::Seconds();
+
+	AActor* actor = PreviewScene->AcquirePooledActor(actorClass, ViewportWidgetEntry.SpawnTransform);
+
+	if (!actor)
+	{
+		actor = SpawnNewActor(actorClass, ViewportWidgetEntry.SpawnTransform);
+	}
+
+	FViewportWidgetStats::AddSpawnedActors(1);
+
+	PreviewScene->PrimeTextures(actor, GetStreamingScreenSize());
+
+	if (IsComponentPSOPrecachingEnabled())
+	{
+		const bool bCompiling = ViewportWidgetPSOPrecache_NM::PrecacheActor(actor);
+
+		FViewportWidgetStats::AddPSOPrecacheResult(!bCompiling);
+
+		if (bCompiling && CVarDelayShowUntilPSOsPrecached.GetValueOnGameThread() != 0)
+		{
+			FCustomPreviewScene::SetActorHiddenInPreview(actor, true);
+			PSOPrecachingActors.Emplace(actor, FPlatformTime::Seconds());
+		}
+	}
+
+	FViewportWidgetTimings::Record(EViewportWidgetTiming::Spawn, (FPlatformTime::Seconds() - SpawnStartTime) * 1000.0, this, entryIndex, actorClass);
+
+	return actor;
+}
+
+AActor* SViewportWidget::SpawnNewActor(UClass* actorClass, const FTransform& transform)
+{
+	UWorld* world = PreviewScene->GetWorld();
+
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnInfo.bNoFail = true;
+	SpawnInfo.ObjectFlags = PreviewScene->GetSpawnObjectFlags();
+
+	AActor* actor = world->SpawnActor(actorClass, &transform, SpawnInfo);
+
+	SetupSpawnedActor(actor, world);
+
+	return actor;
+}
+
+void SViewportWidget::ReleaseEntryActor(AActor* actor)
+{
+	// Gives the actor its own tick functions back before it is pooled or destroyed
+	EntryTickTimers.RemoveAllSwap([actor](const TUniquePtr<FViewportWidgetEntryTickTimer>& EntryTickTimer)
+		{
+			return EntryTickTimer->Actor.Get() == actor;
+		});
+
+	if (USkeletalMeshComponent* SkeletalMesh = actor->FindComponentByClass<USkeletalMeshComponent>())
+	{
+		// Pooled actors animate on their own again when handed out
+		SkeletalMesh->SetLeaderPoseComponent(nullptr);
+	}
+
+	PSOPrecachingActors.RemoveAllSwap([actor](const TPair<TWeakObjectPtr<AActor>, double>& Pending)
+		{
+			return Pending.Key.Get() == actor;
+		});
+
+	if (!PreviewScene || !PreviewScene->ReleaseActorToPool(actor))
+	{
+		if (PreviewScene)
+		{
+			PreviewScene->DissolveGCCluster();
+		}
+
+		actor->GetWorld()->DestroyActor(actor);
+	}
+
+	FViewportWidgetStats::AddSpawnedActors(-1);
+}
+
+void SViewportWidget::RetargetEntries(TArray<FViewportWidgetEntry>& entries, const FTransform& viewTransform)
+{
+	VIEWPORTWIDGET_SCOPE(RetargetEntries);
+
+	CancelPendingSwap();
+
+	DropPrefetch(entries);
+
+	SetViewTransform(viewTransform);
+
+	if (Entries.IsSet() && !IsNotEqual(Entries.Get(), entries))
+	{
+		UpdateEntryLeaders(entries);
+		return;
+	}
+
+	if (FirstDrawPendingTime == 0.0)
+	{
+		FirstDrawPendingTime = FPlatformTime::Seconds();
+	}
+
+	if (!PreviewScene || !PreviewScene->GetWorld())
+	{
+		// Spawned once the preview scene is ready
+		Entries = entries;
+		return;
+	}
+
+	PreviewScene->DissolveGCCluster();
+
+	TArray<FViewportWidgetEntry> oldEntries = Entries.IsSet() ? Entries.Get() : TArray<FViewportWidgetEntry>();
+
+	Entries = entries;
+	TArray<FViewportWidgetEntry>& newEntries = const_cast<TArray<FViewportWidgetEntry>&>(Entries.Get());
+
+	// Keep actors of the same class at the same index, only moving them
+	for (int32 entryIndex = 0; entryIndex < newEntries.Num() && entryIndex < oldEntries.Num(); ++entryIndex)
+	{
+		AActor* actor = oldEntries[entryIndex].ActorObjectPtr.Get();
+
+		if (actor && oldEntries[entryIndex].ActorClassPtr == newEntries[entryIndex].ActorClassPtr)
+		{
+			if (!actor->GetActorTransform().Equals(newEntries[entryIndex].SpawnTransform))
+			{
+				actor->SetActorTransform(newEntries[entryIndex].SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+			}
+
+			newEntries[entryIndex].ActorObjectPtr = actor;
+			oldEntries[entryIndex].ActorObjectPtr.Reset();
+		}
+	}
+
+	// Release first, so the new entries can take the actors from the pool
+	for (FViewportWidgetEntry& oldEntry : oldEntries)
+	{
+		if (AActor* actor = oldEntry.ActorObjectPtr.Get())
+		{
+			ReleaseEntryActor(actor);
+		}
+	}
+
+	for (int32 entryIndex = 0; entryIndex < newEntries.Num(); ++entryIndex)
+	{
+		if (!newEntries[entryIndex].ActorObjectPtr.IsValid())
+		{
+			newEntries[entryIndex].ActorObjectPtr = SpawnEntryActor(newEntries[entryIndex], entryIndex);
+		}
+	}
+
+	ApplyPoseSharing();
+
+	PreviewScene->CreateGCCluster();
+
+	// Spawned actors may bring post process volumes along
+	Client->InvalidateCachedViewSetup();
+
+	RequestRedraw();
+}
+
+void SViewportWidget::SwapEntries(TArray<FViewportWidgetEntry>& entries)
+{
+	if (PendingSwap.IsValid() && !PendingSwap->bSwapped && !IsNotEqual(PendingSwap->Entries, entries))
+	{
+		CopyLeaderEntryIndices(PendingSwap->Entries, entries);
+		return;
+	}
+
+	CancelPendingSwap();
+
+	if (Entries.IsSet() && !IsNotEqual(Entries.Get(), entries))
+	{
+		UpdateEntryLeaders(entries);
+		return;
+	}
+
+	if (!PreviewScene || !PreviewScene->GetWorld() || !Entries.IsSet() || Entries.Get().Num() == 0)
+	{
+		// Nothing shown that could be kept up meanwhile
+		SetEntries(entries);
+		return;
+	}
+
+	PendingSwap = MakeUnique<FViewportWidgetPendingSwap>();
+	PendingSwap->Entries = entries;
+	PendingSwap->LoadHandle = ViewportWidgetStreaming_NM::RequestEntryClasses(entries);
+
+	// The swap holds the classes from now on and its spawns take the pre-spawned actors
+	DropPrefetch(entries);
+}
+
+bool SViewportWidget::IsSwapPending() const
+{
+	return PendingSwap.IsValid();
+}
+
+void SViewportWidget::TickPendingSwap()
+{
+	if (!PendingSwap.IsValid() || !bPreviewSceneReady)
+	{
+		return;
+	}
+
+	VIEWPORTWIDGET_SCOPE(EntrySwap);
+
+	FViewportWidgetPendingSwap& Swap = *PendingSwap;
+
+	if (Swap.bSwapped)
+	{
+		if (Swap.bFenceIssued && Swap.RenderedFence.IsFenceComplete())
+		{
+			// The new entries made it to screen, the old actors can go
+			for (const TWeakObjectPtr<AActor>& OldActor : Swap.OldActors)
+			{
+				if (AActor* actor = OldActor.Get())
+				{
+					ReleaseEntryActor(actor);
+				}
+			}
+
+			PendingSwap.Reset();
+		}
+
+		return;
+	}
+
+	if (Swap.LoadHandle.IsValid() && Swap.LoadHandle->IsLoadingInProgress())
+	{
+		return;
+	}
+
+	const double EndTime = FPlatformTime::Seconds() + CVarSwapSpawnBudget.GetValueOnGameThread() / 1000.0;
+
+	while (Swap.NumSpawned < Swap.Entries.Num())
+	{
+		FViewportWidgetEntry& entry = Swap.Entries[Swap.NumSpawned];
+
+		if (AActor* actor = SpawnEntryActor(entry, Swap.NumSpawned))
+		{
+			FCustomPreviewScene::SetActorHiddenInPreview(actor, true);
+			entry.ActorObjectPtr = actor;
+		}
+
+		Swap.NumSpawned++;
+
+		if (FPlatformTime::Seconds() >= EndTime)
+		{
+			break;
+		}
+	}
+
+	if (Swap.NumSpawned < Swap.Entries.Num())
+	{
+		return;
+	}
+
+	for (const FViewportWidgetEntry& newEntry : Swap.Entries)
+	{
+		if (IsWaitingForPSOs(newEntry.ActorObjectPtr.Get()))
+		{
+			return;
+		}
+	}
+
+	// Everything is spawned, swap both sets within this frame
+	PreviewScene->DissolveGCCluster();
+
+	if (Entries.IsSet())
+	{
+		for (const FViewportWidgetEntry& oldEntry : Entries.Get())
+		{
+			if (AActor* actor = oldEntry.ActorObjectPtr.Get())
+			{
+				FCustomPreviewScene::SetActorHiddenInPreview(actor, true);
+				Swap.OldActors.Add(actor);
+			}
+		}
+	}
+
+	for (const FViewportWidgetEntry& newEntry : Swap.Entries)
+	{
+		if (AActor* actor = newEntry.ActorObjectPtr.Get())
+		{
+			FCustomPreviewScene::SetActorHiddenInPreview(actor, false);
+		}
+	}
+
+	if (FirstDrawPendingTime == 0.0)
+	{
+		FirstDrawPendingTime = FPlatformTime::Seconds();
+	}
+
+	Entries = Swap.Entries;
+	Swap.Entries.Reset();
+	Swap.LoadHandle.Reset();
+	Swap.bSwapped = true;
+
+	ApplyPoseSharing();
+
+	PreviewScene->CreateGCCluster();
+
+	// Spawned actors may bring post process volumes along
+	Client->InvalidateCachedViewSetup();
+
+	RequestRedraw();
+}
+
+void SViewportWidget::OnSwapDrawn()
+{
+	if (PendingSwap.IsValid() && PendingSwap->bSwapped && !PendingSwap->bFenceIssued)
+	{
+		PendingSwap->RenderedFence.BeginFence();
+		PendingSwap->bFenceIssued = true;
+	}
+}
+
+void SViewportWidget::CancelPendingSwap()
+{
+	if (!PendingSwap.IsValid())
+	{
+		return;
+	}
+
+	// Actors of whichever set isn't shown
+	if (PendingSwap->bSwapped)
+	{
+		for (const TWeakObjectPtr<AActor>& OldActor : PendingSwap->OldActors)
+		{
+			if (AActor* actor = OldActor.Get())
+			{
+				ReleaseEntryActor(actor);
+			}
+		}
+	}
+	else
+	{
+		if (PendingSwap->LoadHandle.IsValid())
+		{
+			PendingSwap->LoadHandle->CancelHandle();
+		}
+
+		for (int32 entryIndex = 0; entryIndex < PendingSwap->NumSpawned; ++entryIndex)
+		{
+			if (AActor* actor = PendingSwap->Entries[entryIndex].ActorObjectPtr.Get())
+			{
+				ReleaseEntryActor(actor);
+			}
+		}
+	}
+
+	PendingSwap.Reset();
+}
+
+void SViewportWidget::PrefetchEntries(const TArray<FViewportWidgetEntry>& entries, bool preSpawn)
+{
+	for (const TUniquePtr<FViewportWidgetPrefetch>& Prefetch : Prefetches)
+	{
+		if (!IsNotEqual(Prefetch->Entries, entries))
+		{
+			Prefetch->bPreSpawn |= preSpawn;
+			return;
+		}
+	}
+
+	if (Entries.IsSet() && !IsNotEqual(Entries.Get(), entries))
+	{
+		return;
+	}
+
+	const int32 MaxPrefetches = FMath::Max(CVarMaxPrefetches.GetValueOnGameThread(), 1);
+
+	while (Prefetches.Num() >= MaxPrefetches)
+	{
+		// Pre-spawned actors stay in the pool, only the classes are no longer held
+		Prefetches.RemoveAt(0);
+	}
+
+	TUniquePtr<FViewportWidgetPrefetch> Prefetch = MakeUnique<FViewportWidgetPrefetch>();
+	Prefetch->Entries = entries;
+	Prefetch->bPreSpawn = preSpawn;
+
+	// Loading a class loads the meshes, materials and textures its components reference along with it
+	// Below the default priority, so loads of entries that are shown now come first
+	Prefetch->LoadHandle = ViewportWidgetStreaming_NM::RequestEntryClasses(entries, FStreamableManager::DefaultAsyncLoadPriority - 1);
+
+	Prefetches.Add(MoveTemp(Prefetch));
+}
+
+int32 SViewportWidget::GetNumPrefetches() const
+{
+	return Prefetches.Num();
+}
+
+bool SViewportWidget::IsWaitingForPSOs(const AActor* actor) const
+{
+	return actor && PSOPrecachingActors.ContainsByPredicate([actor](const TPair<TWeakObjectPtr<AActor>, double>& Pending)
+		{
+			return Pending.Key.Get() == actor;
+		});
+}
+
+void SViewportWidget::TickPSOPrecachingActors()
+{
+	if (PSOPrecachingActors.Num() == 0)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const double Timeout = CVarPSOPrecacheShowTimeout.GetValueOnGameThread();
+
+	for (int32 Index = PSOPrecachingActors.Num() - 1; Index >= 0; --Index)
+	{
+		AActor* actor = PSOPrecachingActors[Index].Key.Get();
+
+		if (actor && ViewportWidgetPSOPrecache_NM::IsCompiling(actor) && Now - PSOPrecachingActors[Index].Value < Timeout)
+		{
+			continue;
+		}
+
+		PSOPrecachingActors.RemoveAtSwap(Index);
+
+		// Actors of a pending swap are shown by the swap
+		const bool bInPendingSwap = PendingSwap.IsValid() && !PendingSwap->bSwapped && PendingSwap->Entries.ContainsByPredicate([actor](const FViewportWidgetEntry& Entry)
+			{
+				return Entry.ActorObjectPtr.Get() == actor;
+			});
+
+		if (actor && !bInPendingSwap)
+		{
+			FCustomPreviewScene::SetActorHiddenInPreview(actor, false);
+
+			RequestRedraw();
+		}
+	}
+}
+
+void SViewportWidget::DropPrefetch(const TArray<FViewportWidgetEntry>& entries)
+{
+	Prefetches.RemoveAll([&entries](const TUniquePtr<FViewportWidgetPrefetch>& Prefetch)
+		{
+			return !IsNotEqual(Prefetch->Entries, entries);
+		});
+}
+
+void SViewportWidget::TickPrefetches()
+{
+	if (Prefetches.Num() == 0 || !bPreviewSceneReady || (PendingSwap.IsValid() && !PendingSwap->bSwapped))
+	{
+		return;
+	}
+
+	UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr;
+
+	if (!world)
+	{
+		return;
+	}
+
+	VIEWPORTWIDGET_SCOPE(Prefetch);
+
+	int32 NumSpawnsLeft = CVarPrefetchSpawnsPerFrame.GetValueOnGameThread();
+
+	for (const TUniquePtr<FViewportWidgetPrefetch>& Prefetch : Prefetches)
+	{
+		if (Prefetch->LoadHandle.IsValid() && Prefetch->LoadHandle->IsLoadingInProgress())
+		{
+			continue;
+		}
+
+		if (!Prefetch->bPSOsPrecached)
+		{
+			TSet<UClass*> PrecachedClasses;
+
+			for (const FViewportWidgetEntry& entry : Prefetch->Entries)
+			{
+				UClass* actorClass = entry.ActorClassPtr.Get();
+
+				if (actorClass && !PrecachedClasses.Contains(actorClass))
+				{
+					ViewportWidgetPSOPrecache_NM::PrecacheClass(actorClass);
+					PrecachedClasses.Add(actorClass);
+				}
+			}
+
+			Prefetch->bPSOsPrecached = true;
+		}
+
+		if (!Prefetch->bPreSpawn)
+		{
+			continue;
+		}
+
+		while (NumSpawnsLeft > 0 && Prefetch->NextEntryIndex < Prefetch->Entries.Num())
+		{
+			const FViewportWidgetEntry& entry = Prefetch->Entries[Prefetch->NextEntryIndex++];
+
+			UClass* actorClass = entry.ActorClassPtr.Get();
+
+			if (!actorClass)
+			{
+				continue;
+			}
+
+			// One pooled actor for every entry of the class up to this one
+			int32 NumNeeded = 0;
+
+			for (int32 entryIndex = 0; entryIndex < Prefetch->NextEntryIndex; ++entryIndex)
+			{
+				NumNeeded += Prefetch->Entries[entryIndex].ActorClassPtr == entry.ActorClassPtr ? 1 : 0;
+			}
+
+			if (PreviewScene->GetNumPooledActors(actorClass) >= NumNeeded)
+			{
+				continue;
+			}
+
+			AActor* actor = SpawnNewActor(actorClass, entry.SpawnTransform);
+
+			PreviewScene->PrimeTextures(actor, GetStreamingScreenSize());
+
+			NumSpawnsLeft--;
+
+			if (!PreviewScene->ReleaseActorToPool(actor))
+			{
+				// The pool is full, more pre-spawning would only be thrown away
+				PreviewScene->DissolveGCCluster();
+				world->DestroyActor(actor);
+				Prefetch->NextEntryIndex = Prefetch->Entries.Num();
+			}
+		}
+	}
+}
+
+//------------------------------------------------------
+// UViewportWidget
+//------------------------------------------------------
+
+static TAutoConsoleVariable<float> CVarPreservedStateTimeout(
+	TEXT("ViewportWidget.PreservedStateTimeout"),
+	2.f,
+	TEXT("Seconds the preview state of a released widget with bPreservePreviewAcrossRebuilds is kept for a rebuild before it is torn down."),
+	ECVF_Default);
+
+void UViewportWidget::SynchronizeProperties()
+{
+	Super::SynchronizeProperties();
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetViewTransform(ViewTransform);
+		MyViewportWidget->SetEntries(Entries);
+		MyViewportWidget->SetPostProcessLayers(GetEffectivePostProcessLayers());
+		MyViewportWidget->SetLayout(Layout);
+		MyViewportWidget->SetPanes(Panes);
+		MyViewportWidget->SetShowStatsOverlay(bShowStatsOverlay);
+		MyViewportWidget->SetSharePoses(bSharePoses);
+	}
+}
+
+void UViewportWidget::ReleaseSlateResources(bool bReleaseChildren)
+{
+	if (bPreservePreviewAcrossRebuilds && MyViewportWidget.IsValid())
+	{
+		ReleasePreservedState();
+
+		PreservedState = MyViewportWidget->DetachPreservedState();
+
+		// Only a rebuild right after the release takes the state over, anything else would keep the preview world alive for nothing
+		PreservedStateTimeoutHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this](float)
+			{
+				PreservedStateTimeoutHandle.Reset();
+				PreservedState.Reset();
+				return false;
+			}), CVarPreservedStateTimeout.GetValueOnGameThread());
+	}
+
+	MyViewportWidget.Reset();
+
+	Super::ReleaseSlateResources(bReleaseChildren);
+}
+
+void UViewportWidget::RemoveFromParent()
+{
+	Super::RemoveFromParent();
+
+	ReleasePreservedState();
+}
+
+void UViewportWidget::ReleasePreservedState()
+{
+	if (PreservedStateTimeoutHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(PreservedStateTimeoutHandle);
+		PreservedStateTimeoutHandle.Reset();
+	}
+
+	PreservedState.Reset();
+}
+
+void UViewportWidget::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	Super::AddReferencedObjects(InThis, Collector);
+
+	UViewportWidget* This = CastChecked<UViewportWidget>(InThis);
+
+	if (This->PostProcessLayers.IsValid())
+	{
+		This->PostProcessLayers->AddReferencedObjects(Collector);
+	}
+}
+
+void UViewportWidget::BeginDestroy()
+{
+	if (PreservedStateTimeoutHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(PreservedStateTimeoutHandle);
+		PreservedStateTimeoutHandle.Reset();
+	}
+
+	if (PreservedState.IsValid())
+	{
+		// BeginDestroy runs inside garbage collection, actors can't be destroyed there
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([State = MoveTemp(PreservedState)](float) mutable
+			{
+				State.Reset();
+				return false;
+			}));
+	}
+
+	Super::BeginDestroy();
+}
+
+#if WITH_EDITOR
+const FText UViewportWidget::GetPaletteCategory()
+{
+	return LOCTEXT("Advanced", "Advanced");
+}
+#endif
+
+void UViewportWidget::SetViewTransform(FTransform viewTransform)
+{
+	ViewTransform = viewTransform;
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetViewTransform(ViewTransform);
+	}
+}
+
+void UViewportWidget::SetEntries(const TArray<FViewportWidgetEntry>& entries)
+{
+	Entries = entries;
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetEntries(Entries);
+	}
+}
+
+void UViewportWidget::RetargetEntries(const TArray<FViewportWidgetEntry>& entries, FTransform viewTransform)
+{
+	Entries = entries;
+	ViewTransform = viewTransform;
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->RetargetEntries(Entries, ViewTransform);
+	}
+}
+
+void UViewportWidget::SwapEntries(const TArray<FViewportWidgetEntry>& entries)
+{
+	Entries = entries;
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SwapEntries(Entries);
+	}
+}
+
+bool UViewportWidget::IsSwapPending() const
+{
+	return MyViewportWidget.IsValid() && MyViewportWidget->IsSwapPending();
+}
+
+void UViewportWidget::PrefetchEntries(const TArray<FViewportWidgetEntry>& entries, bool preSpawnActors)
+{
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->PrefetchEntries(entries, preSpawnActors);
+	}
+}
+
+void UViewportWidget::SetRenderMode(EViewportWidgetRenderMode renderMode, float scheduledRedrawInterval)
+{
+	RenderMode = renderMode;
+	ScheduledRedrawInterval = scheduledRedrawInterval;
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetRenderMode(RenderMode, ScheduledRedrawInterval);
+	}
+}
+
+void UViewportWidget::SetPostProcessAsset(UViewportWidgetPostProcessAsset* postProcessAsset)
+{
+	PostProcessAsset = postProcessAsset;
+	PostProcessLayers.Reset();
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetPostProcessLayers(GetEffectivePostProcessLayers());
+	}
+}
+
+void UViewportWidget::SetPostProcessLayers(const TArray<FViewportWidgetPostProcessLayer>& postProcessLayers)
+{
+	PostProcessLayers = FCustomViewportPostProcessLayers::Create(postProcessLayers);
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetPostProcessLayers(GetEffectivePostProcessLayers());
+	}
+}
+
+TSharedPtr<const FCustomViewportPostProcessLayers> UViewportWidget::GetEffectivePostProcessLayers() const
+{
+	if (PostProcessLayers.IsValid())
+	{
+		return PostProcessLayers;
+	}
+
+	return PostProcessAsset ? PostProcessAsset->GetLayerSet() : TSharedPtr<const FCustomViewportPostProcessLayers>();
+}
+
+void UViewportWidget::RequestRedraw()
+{
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->RequestRedraw();
+	}
+}
+
+void UViewportWidget::SetLayout(EViewportWidgetLayout layout)
+{
+	Layout = layout;
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetLayout(Layout);
+		MyViewportWidget->SetPanes(Panes);
 	}
 }
 
-//------------------------------------------------------
-// UViewportWidget
-//------------------------------------------------------
-
-void UViewportWidget::SynchronizeProperties()
+void UViewportWidget::SetPanes(const TArray<FViewportWidgetPane>& panes)
 {
-	Super::SynchronizeProperties();
+	Panes = panes;
 
 	if (MyViewportWidget.IsValid())
 	{
-		MyViewportWidget->SetViewTransform(ViewTransform);
-		MyViewportWidget->SetEntries(Entries);
+		MyViewportWidget->SetPanes(Panes);
 	}
 }
 
-void UViewportWidget::ReleaseSlateResources(bool bReleaseChildren)
+void UViewportWidget::SetSharePoses(bool sharePoses)
 {
-	MyViewportWidget.Reset();
+	bSharePoses = sharePoses;
 
-	Super::ReleaseSlateResources(bReleaseChildren);
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetSharePoses(bSharePoses);
+	}
 }
 
-#if WITH_EDITOR
-const FText UViewportWidget::GetPaletteCategory()
+void UViewportWidget::SetShowStatsOverlay(bool showStatsOverlay)
 {
-	return LOCTEXT("Advanced", "Advanced");
+	bShowStatsOverlay = showStatsOverlay;
+
+	if (MyViewportWidget.IsValid())
+	{
+		MyViewportWidget->SetShowStatsOverlay(bShowStatsOverlay);
+	}
 }
-#endif
 
-void UViewportWidget::SetViewTransform(FTransform viewTransform)
+void UViewportWidget::ShareSceneWith(UViewportWidget* source)
 {
-	ViewTransform = viewTransform;
+	if (!source || source == this)
+	{
+		return;
+	}
+
+	if (!source->ViewportGroup.IsValid())
+	{
+		// The source keeps its current scene and actors when it already has a widget
+		const TSharedPtr<FCustomPreviewScene> SourcePreviewScene = source->MyViewportWidget.IsValid() ? source->MyViewportWidget->GetPreviewScene() : nullptr;
+
+		source->ViewportGroup = MakeShared<FCustomViewportGroup>(SourcePreviewScene.IsValid() ? SourcePreviewScene.ToSharedRef() : SViewportWidget::MakeDefaultPreviewScene());
+
+		if (source->MyViewportWidget.IsValid())
+		{
+			source->MyViewportWidget->SetViewportGroup(source->ViewportGroup);
+		}
+	}
+
+	ViewportGroup = source->ViewportGroup;
 
 	if (MyViewportWidget.IsValid())
 	{
-		MyViewportWidget->SetViewTransform(ViewTransform);
+		MyViewportWidget->SetViewportGroup(ViewportGroup);
 	}
 }
 
-void UViewportWidget::SetEntries(const TArray<FViewportWidgetEntry>& entries)
+void UViewportWidget::StopSharingScene()
 {
-	Entries = entries;
+	ViewportGroup.Reset();
 
 	if (MyViewportWidget.IsValid())
 	{
-		MyViewportWidget->SetEntries(Entries);
+		MyViewportWidget->SetViewportGroup(ViewportGroup);
 	}
 }
 
+TArray<FViewportWidgetEntryCost> UViewportWidget::GetEntryCosts() const
+{
+	return MyViewportWidget.IsValid() ? MyViewportWidget->GetEntryCosts() : TArray<FViewportWidgetEntryCost>();
+}
+
+TArray<FViewportWidgetEntryCost> UViewportWidget::GetClassCosts() const
+{
+	return SViewportWidget::AggregateCostsByClass(GetEntryCosts());
+}
+
 AActor* UViewportWidget::GetSpawnedActor(const int32 entryIndex) const
 {
 	if (MyViewportWidget.IsValid())
@@ -476,10 +4071,55 @@ TSharedRef<SWidget> UViewportWidget::RebuildWidget()
 {
 	MyViewportWidget = SNew(SViewportWidget)
 		.ViewTransform(ViewTransform)
-		.Entries(Entries);
+		.Entries(Entries)
+		.ViewStateReleaseDelay(ViewStateReleaseDelay)
+		.RenderMode(RenderMode)
+		.ScheduledRedrawInterval(ScheduledRedrawInterval)
+		.UsePooledRenderTarget(bUsePooledRenderTarget)
+		.PostProcessLayers(GetEffectivePostProcessLayers())
+		.ViewportGroup(ViewportGroup)
+		.Layout(Layout)
+		.Panes(Panes)
+		.ShowStatsOverlay(bShowStatsOverlay)
+		.SharePoses(bSharePoses)
+		.StagedInitialization(bStagedInitialization)
+		.PlaceholderBrush(&PlaceholderBrush)
+		.PreservedState(PreservedState);
+
+	ReleasePreservedState();
+
 	return MyViewportWidget.ToSharedRef();
 }
 
+//------------------------------------------------------
+// UViewportWidgetListEntry
+//------------------------------------------------------
+
+void UViewportWidgetListEntry::NativeOnListItemObjectSet(UObject* ListItemObject)
+{
+	IUserObjectListEntry::NativeOnListItemObjectSet(ListItemObject);
+
+	TArray<FViewportWidgetEntry> ItemEntries;
+	FTransform ItemViewTransform = FTransform::Identity;
+
+	if (ViewportWidget && GetListItemPreview(ListItemObject, ItemEntries, ItemViewTransform))
+	{
+		ViewportWidget->RetargetEntries(ItemEntries, ItemViewTransform);
+	}
+}
+
+bool UViewportWidgetListEntry::GetListItemPreview_Implementation(UObject* ListItemObject, TArray<FViewportWidgetEntry>& OutEntries, FTransform& OutViewTransform) const
+{
+	if (const UViewportWidgetListItem* ListItem = Cast<UViewportWidgetListItem>(ListItemObject))
+	{
+		OutEntries = ListItem->Entries;
+		OutViewTransform = ListItem->ViewTransform;
+		return true;
+	}
+
+	return false;
+}
+
 //------------------------------------------------------
 // FCustomViewportClient
 //------------------------------------------------------
@@ -503,27 +4143,23 @@ private:
 	friend class FCustomViewportClient;
 };
 
-static int32 ViewOptionIndex = 0;
-static TArray<ECustomViewportType> ViewOptions;
-
-void InitViewOptionsArray()
+static const ECustomViewportType ViewOptions[] =
 {
-	ViewOptions.Empty();
-
-	ECustomViewportType Front = ECustomViewportType::CVT_OrthoXZ;
-	ECustomViewportType Back = ECustomViewportType::CVT_OrthoNegativeXZ;
-	ECustomViewportType Top = ECustomViewportType::CVT_OrthoXY;
-	ECustomViewportType Bottom = ECustomViewportType::CVT_OrthoNegativeXY;
-	ECustomViewportType Left = ECustomViewportType::CVT_OrthoYZ;
-	ECustomViewportType Right = ECustomViewportType::CVT_OrthoNegativeYZ;
+	ECustomViewportType::CVT_OrthoXZ,			// Front
+	ECustomViewportType::CVT_OrthoNegativeXZ,	// Back
+	ECustomViewportType::CVT_OrthoXY,			// Top
+	ECustomViewportType::CVT_OrthoNegativeXY,	// Bottom
+	ECustomViewportType::CVT_OrthoYZ,			// Left
+	ECustomViewportType::CVT_OrthoNegativeYZ,	// Right
+};
 
-	ViewOptions.Add(Front);
-	ViewOptions.Add(Back);
-	ViewOptions.Add(Top);
-	ViewOptions.Add(Bottom);
-	ViewOptions.Add(Left);
-	ViewOptions.Add(Right);
-}
+/** Viewport types of the panes added by a split layout, the first pane keeps the viewport's own type */
+static const ECustomViewportType DefaultPaneViewportTypes[FCustomViewportClient::MaxPanes - 1] =
+{
+	ECustomViewportType::CVT_OrthoXY,	// Top
+	ECustomViewportType::CVT_OrthoXZ,	// Front
+	ECustomViewportType::CVT_OrthoYZ,	// Left
+};
 
 const EViewModeIndex FCustomViewportClient::DefaultPerspectiveViewMode = VMI_Lit;
 const EViewModeIndex FCustomViewportClient::DefaultOrthoViewMode = VMI_BrushWireframe;
@@ -553,6 +4189,124 @@ namespace CustomViewportDefs_NM
 	inline const float DefaultPerspectiveFOVAngle(90.0f);
 }
 
+namespace ViewportWidgetPostProcess_NM
+{
+	/** Bumped whenever console variables change, r.DefaultFeature.* ones set the base values volumes are blended onto */
+	uint32 CVarSerial = 0;
+
+	static FAutoConsoleVariableSink CVarSink(FConsoleCommandDelegate::CreateLambda([]()
+		{
+			CVarSerial++;
+		}));
+
+	/**
+	 * @return Cheap hash of everything StartFinalPostprocessSettings reads from the world besides the view location:
+	 * each volume's identity, enabled state, weight, priority, blend radius, transform and settings, plus the CVar serial
+	 */
+	uint32 CalcVolumeSignature(const UWorld* World)
+	{
+		uint32 Signature = GetTypeHash(CVarSerial);
+
+		if (!World)
+		{
+			return Signature;
+		}
+
+		for (IInterface_PostProcessVolume* Volume : World->PostProcessVolumes)
+		{
+			const FPostProcessVolumeProperties Properties = Volume->GetProperties();
+
+			Signature = HashCombine(Signature, GetTypeHash(Volume));
+			Signature = HashCombine(Signature, GetTypeHash(Properties.bIsEnabled) ^ (GetTypeHash(Properties.bIsUnbound) << 1));
+			Signature = HashCombine(Signature, GetTypeHash(Properties.BlendWeight));
+			Signature = HashCombine(Signature, GetTypeHash(Properties.Priority));
+			Signature = HashCombine(Signature, GetTypeHash(Properties.BlendRadius));
+
+			// Volumes may be moved by the previewed Blueprints, post process components travel with their entries
+			const UObject* VolumeObject = Volume->_getUObject();
+
+			if (const AActor* VolumeActor = Cast<AActor>(VolumeObject))
+			{
+				Signature = HashCombine(Signature, GetTypeHash(VolumeActor->GetActorTransform()));
+			}
+			else if (const USceneComponent* VolumeComponent = Cast<USceneComponent>(VolumeObject))
+			{
+				Signature = HashCombine(Signature, GetTypeHash(VolumeComponent->GetComponentTransform()));
+			}
+
+			if (Properties.Settings)
+			{
+				Signature = FCrc::MemCrc32(Properties.Settings, sizeof(FPostProcessSettings), Signature);
+			}
+		}
+
+		return Signature;
+	}
+}
+
+static TAutoConsoleVariable<float> CVarViewStateReleaseDelay(
+	TEXT("ViewportWidget.ViewStateReleaseDelay"),
+	0.f,
+	TEXT("Seconds a hidden viewport widget keeps its scene view states (temporal AA, eye adaptation, occlusion history).\n")
+	TEXT("View states are allocated again on next draw. 0 keeps them for the whole lifetime of the widget."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarViewExtensionRefreshFrames(
+	TEXT("ViewportWidget.ViewExtensionRefreshFrames"),
+	0,
+	TEXT("Number of frames a viewport widget reuses its gathered scene view extensions before gathering them again.\n")
+	TEXT("0 gathers them every frame, so IsActiveThisFrame is respected and unregistered extensions are dropped right away."),
+	ECVF_Default);
+
+static TArray<FCustomViewportClient*> LiveCustomViewportClients;
+
+static SIZE_T TotalViewStateBytesReleased = 0;
+
+static TAutoConsoleVariable<int32> CVarShowStatsOverlay(
+	TEXT("ViewportWidget.ShowStatsOverlay"),
+	0,
+	TEXT("Draws the performance overlay in every viewport widget.\n")
+	TEXT("0: only in widgets with the overlay enabled, 1: in all widgets"),
+	ECVF_Default);
+
+static FAutoConsoleCommand DumpViewStatesCommand(
+	TEXT("ViewportWidget.DumpViewStates"),
+	TEXT("Logs view state usage of all live viewport widgets."),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			for (const FCustomViewportClient* Client : FCustomViewportClient::GetLiveClients())
+			{
+				UE_LOG(LogViewportWidget, Display, TEXT("%p: %s, %llu bytes held, %llu bytes released"),
+					Client,
+					Client->HasReleasedViewStates() ? TEXT("released") : TEXT("allocated"),
+					(uint64)Client->GetViewStateSizeBytes(),
+					(uint64)Client->GetViewStateBytesReleased());
+			}
+
+			UE_LOG(LogViewportWidget, Display, TEXT("Total released: %llu bytes"), (uint64)FCustomViewportClient::GetTotalViewStateBytesReleased());
+		}));
+
+static FAutoConsoleCommand EntryCostReportCommand(
+	TEXT("ViewportWidget.EntryCostReport"),
+	TEXT("Logs tick time, component, primitive and bone counts and estimated render cost of every entry of live viewport widgets, summed up by entry class.\n")
+	TEXT("Tick times are only measured while ViewportWidget.TrackEntryCosts is 1.\n")
+	TEXT("Usage: ViewportWidget.EntryCostReport [widget id], ids are the #numbers in this report, the memory report and hitch logs. Without an id all widgets are reported"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const uint32 WidgetId = Args.Num() > 0 ? (uint32)FCString::Atoi(*Args[0].Replace(TEXT("#"), TEXT(""))) : 0;
+
+			for (const FCustomViewportClient* Client : FCustomViewportClient::GetLiveClients())
+			{
+				// Clients detached into preserved state have no widget
+				TSharedPtr<SViewportWidget> Widget = Client->GetViewportWidget();
+
+				if (Widget.IsValid() && (WidgetId == 0 || Widget->GetWidgetId() == WidgetId))
+				{
+					Widget->LogEntryCosts();
+				}
+			}
+		}));
+
 FCustomViewportClient::FCustomViewportClient(FCustomPreviewScene* InPreviewScene, const TWeakPtr<SViewportWidget>& InViewportWidget)
 	: ImmersiveDelegate()
 	, VisibilityDelegate()
@@ -581,6 +4335,9 @@ FCustomViewportClient::FCustomViewportClient(FCustomPreviewScene* InPreviewScene
 	, bIsRealtime(false)
 	, ViewportWidget(InViewportWidget)
 	, PreviewScene(InPreviewScene)
+	, LastDrawTime(0.0)
+	, ViewStateReleaseDelay(-1.f)
+	, ViewStateBytesReleased(0)
 	, PerspViewModeIndex(DefaultPerspectiveViewMode)
 	, OrthoViewModeIndex(DefaultOrthoViewMode)
 	, ViewModeParam(-1)
@@ -588,10 +4345,11 @@ FCustomViewportClient::FCustomViewportClient(FCustomPreviewScene* InPreviewScene
 	, FarPlane(0.0f)
 	, bInGameViewMode(false)
 {
-	InitViewOptionsArray();
+	LiveCustomViewportClients.Add(this);
 
-	FSceneInterface* Scene = GetScene();
-	ViewState.Allocate(Scene ? Scene->GetFeatureLevel() : GMaxRHIFeatureLevel);
+	ViewModifierParams = MakeUnique<FCustomViewportViewModifierParams>();
+
+	AllocateViewState();
 
 	// NOTE: StereoViewState will be allocated on demand, for viewports than end up drawing in stereo
 
@@ -604,30 +4362,338 @@ FCustomViewportClient::FCustomViewportClient(FCustomPreviewScene* InPreviewScene
 
 	RequestUpdateDPIScale();
 
-#if WITH_EDITOR
-	FSlateApplication::Get().OnWindowDPIScaleChanged().AddRaw(this, &FCustomViewportClient::HandleWindowDPIScaleChanged);
-#endif
+#if WITH_EDITOR
+	if (FSlateApplication::IsInitialized())
+	{
+		FSlateApplication::Get().OnWindowDPIScaleChanged().AddRaw(this, &FCustomViewportClient::HandleWindowDPIScaleChanged);
+	}
+#endif
+}
+
+FCustomViewportClient::~FCustomViewportClient()
+{
+	if (Viewport)
+	{
+		UE_LOG(LogTemp, Fatal, TEXT("Viewport != NULL in FCustomViewportClient destructor."));
+	}
+
+	LiveCustomViewportClients.RemoveSingleSwap(this);
+
+	if (FSlateApplication::IsInitialized())
+	{
+#if WITH_EDITOR
+		FSlateApplication::Get().OnWindowDPIScaleChanged().RemoveAll(this);
+#endif
+	}
+}
+
+bool FCustomViewportClient::ToggleRealtime()
+{
+	SetRealtime(!bIsRealtime);
+	return bIsRealtime;
+}
+
+float FCustomViewportClient::GetViewStateReleaseDelay() const
+{
+	return ViewStateReleaseDelay < 0.f ? CVarViewStateReleaseDelay.GetValueOnGameThread() : ViewStateReleaseDelay;
+}
+
+SIZE_T FCustomViewportClient::ReleaseViewStatesIfHidden(double CurrentTime)
+{
+	const float ReleaseDelay = GetViewStateReleaseDelay();
+	if (ReleaseDelay <= 0.f || HasReleasedViewStates())
+	{
+		return 0;
+	}
+
+	// Never drawn yet, start counting from now
+	if (LastDrawTime == 0.0)
+	{
+		LastDrawTime = CurrentTime;
+		return 0;
+	}
+
+	if (CurrentTime - LastDrawTime < ReleaseDelay || IsVisible())
+	{
+		return 0;
+	}
+
+	return ReleaseViewStates();
+}
+
+SIZE_T FCustomViewportClient::ReleaseViewStates()
+{
+	const SIZE_T BytesReleased = GetViewStateSizeBytes();
+
+	DestroyViewStates();
+
+	ViewStateBytesReleased += BytesReleased;
+	TotalViewStateBytesReleased += BytesReleased;
+
+	UE_LOG(LogViewportWidget, Verbose, TEXT("Released view states of hidden viewport %p (%llu bytes)"), this, (uint64)BytesReleased);
+
+	return BytesReleased;
+}
+
+void FCustomViewportClient::DestroyViewStates()
+{
+	ViewState.Destroy();
+
+	for (FSceneViewStateReference& StereoViewState : StereoViewStates)
+	{
+		StereoViewState.Destroy();
+	}
+	StereoViewStates.Empty();
+
+	for (FCustomViewportPane& Pane : Panes)
+	{
+		Pane.ViewState.Destroy();
+	}
+}
+
+SIZE_T FCustomViewportClient::GetViewStateSizeBytes() const
+{
+	SIZE_T SizeBytes = 0;
+
+	if (const FSceneViewStateInterface* ViewStateInterface = ViewState.GetReference())
+	{
+		SizeBytes += ViewStateInterface->GetSizeBytes();
+	}
+
+	for (const FSceneViewStateReference& StereoViewState : StereoViewStates)
+	{
+		if (const FSceneViewStateInterface* ViewStateInterface = StereoViewState.GetReference())
+		{
+			SizeBytes += ViewStateInterface->GetSizeBytes();
+		}
+	}
+
+	for (const FCustomViewportPane& Pane : Panes)
+	{
+		if (const FSceneViewStateInterface* ViewStateInterface = Pane.ViewState.GetReference())
+		{
+			SizeBytes += ViewStateInterface->GetSizeBytes();
+		}
+	}
+
+	return SizeBytes;
+}
+
+SIZE_T FCustomViewportClient::GetTotalViewStateBytesReleased() { return TotalViewStateBytesReleased; }
+
+const TArray<FCustomViewportClient*>& FCustomViewportClient::GetLiveClients() { return LiveCustomViewportClients; }
+
+const FMatrix& FCustomViewportClient::GetOrthoViewRotationMatrix(ECustomViewportType InViewportType)
+{
+	// Indexed by ECustomViewportType, perspective entry is unused
+	static const FMatrix OrthoViewRotationMatrices[] =
+	{
+		FMatrix::Identity,
+		// CVT_OrthoFreelook
+		FMatrix(
+			FPlane(0, 0, 1, 0),
+			FPlane(1, 0, 0, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1)),
+		// CVT_OrthoXY
+		FMatrix(
+			FPlane(1, 0, 0, 0),
+			FPlane(0, -1, 0, 0),
+			FPlane(0, 0, -1, 0),
+			FPlane(0, 0, 0, 1)),
+		// CVT_OrthoXZ
+		FMatrix(
+			FPlane(1, 0, 0, 0),
+			FPlane(0, 0, -1, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1)),
+		// CVT_OrthoYZ
+		FMatrix(
+			FPlane(0, 0, 1, 0),
+			FPlane(1, 0, 0, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1)),
+		// CVT_OrthoNegativeXY
+		FMatrix(
+			FPlane(-1, 0, 0, 0),
+			FPlane(0, -1, 0, 0),
+			FPlane(0, 0, 1, 0),
+			FPlane(0, 0, 0, 1)),
+		// CVT_OrthoNegativeXZ
+		FMatrix(
+			FPlane(-1, 0, 0, 0),
+			FPlane(0, 0, 1, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1)),
+		// CVT_OrthoNegativeYZ
+		FMatrix(
+			FPlane(0, 0, -1, 0),
+			FPlane(-1, 0, 0, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1)),
+	};
+
+	const int32 Index = (int32)InViewportType;
+	checkf(Index > 0 && Index < UE_ARRAY_COUNT(OrthoViewRotationMatrices), TEXT("Unknown orthographic viewport type"));
+	return OrthoViewRotationMatrices[Index];
+}
+
+void FCustomViewportClient::SetPreviewScene(FCustomPreviewScene* InPreviewScene)
+{
+	if (PreviewScene != InPreviewScene)
+	{
+		// Recreated for the new scene right away, nothing is saved
+		DestroyViewStates();
+
+		PreviewScene = InPreviewScene;
+
+		AllocateViewState();
+		InvalidateCachedViewSetup();
+	}
+}
+
+void FCustomViewportClient::SetPostProcessLayers(const TSharedPtr<const FCustomViewportPostProcessLayers>& InPostProcessLayers)
+{
+	PostProcessLayers = InPostProcessLayers;
+	InvalidateCachedPostProcess();
+}
+
+void FCustomViewportClient::InvalidateCachedViewSetup()
+{
+	CachedViewSetup.bValid = false;
+	bViewExtensionsDirty = true;
+
+	for (FCustomViewportPane& Pane : Panes)
+	{
+		Pane.CachedViewSetup.bValid = false;
+	}
+
+	InvalidateCachedPostProcess();
+}
+
+void FCustomViewportClient::InvalidateCachedPostProcess()
+{
+	CachedPostProcess.bValid = false;
+
+	for (FCustomViewportPane& Pane : Panes)
+	{
+		Pane.CachedPostProcess.bValid = false;
+	}
+}
+
+void FCustomViewportClient::SetNumPanes(int32 InNumPanes)
+{
+	const int32 NumPanes = InNumPanes <= 1 ? 1 : InNumPanes == 2 ? 2 : MaxPanes;
+
+	if (NumPanes == GetNumPanes())
+	{
+		return;
+	}
+
+	const int32 OldNumPanes = GetNumPanes();
+
+	// Removed panes free their view states with them
+	Panes.SetNum(NumPanes - 1);
+
+	for (int32 PaneIndex = OldNumPanes; PaneIndex < NumPanes; ++PaneIndex)
+	{
+		FCustomViewportPane& Pane = Panes[PaneIndex - 1];
+		Pane.ViewportType = DefaultPaneViewportTypes[PaneIndex - 1];
+		Pane.ViewTransform.SetLocation(GetViewLocation());
+	}
+
+	InvalidateCachedViewSetup();
+	Invalidate();
+}
+
+void FCustomViewportClient::SetPaneView(int32 PaneIndex, ECustomViewportType InViewportType, const FVector& InViewLocation, const FRotator& InViewRotation)
+{
+	if (PaneIndex == 0)
+	{
+		if (ViewportType != InViewportType)
+		{
+			SetViewportType(InViewportType);
+		}
+
+		SetViewLocation(InViewLocation);
+		SetViewRotation(InViewRotation);
+	}
+	else if (Panes.IsValidIndex(PaneIndex - 1))
+	{
+		FCustomViewportPane& Pane = Panes[PaneIndex - 1];
+		Pane.ViewportType = InViewportType;
+		Pane.ViewTransform.SetLocation(InViewLocation);
+		Pane.ViewTransform.SetRotation(InViewRotation);
+		Pane.CachedViewSetup.bValid = false;
+	}
+
+	Invalidate();
+}
+
+FIntRect FCustomViewportClient::GetPaneRect(int32 NumPanes, int32 PaneIndex, const FIntPoint& InViewportSize)
+{
+	if (NumPanes <= 1)
+	{
+		return FIntRect(FIntPoint::ZeroValue, InViewportSize);
+	}
+
+	const FIntPoint HalfSize(InViewportSize.X / 2, InViewportSize.Y / 2);
+	const int32 Column = PaneIndex % 2;
+	const int32 Row = NumPanes == 2 ? 0 : PaneIndex / 2;
+
+	const FIntPoint Min(Column * HalfSize.X, Row * HalfSize.Y);
+	const FIntPoint Max(Column == 0 ? HalfSize.X : InViewportSize.X, (NumPanes == 2 || Row == 1) ? InViewportSize.Y : HalfSize.Y);
+
+	return FIntRect(Min, Max);
+}
+
+void FCustomViewportClient::AddPaneViews(FSceneViewFamily& ViewFamily, FViewport* InViewport, const FIntPoint& Offset)
+{
+	const int32 NumPanes = GetNumPanes();
+	const FIntPoint ViewportSize = InViewport->GetSizeXY();
+
+	for (int32 PaneIndex = 0; PaneIndex < NumPanes; ++PaneIndex)
+	{
+		const FIntRect PaneRect = GetPaneRect(NumPanes, PaneIndex, ViewportSize);
+
+		ActivePaneIndex = PaneIndex;
+		ViewRectOffset = Offset + PaneRect.Min;
+		ViewRectSize = NumPanes > 1 ? PaneRect.Size() : FIntPoint::ZeroValue;
+
+		AddView(ViewFamily, InViewport, INDEX_NONE);
+	}
+
+	ActivePaneIndex = 0;
+	ViewRectOffset = FIntPoint::ZeroValue;
+	ViewRectSize = FIntPoint::ZeroValue;
 }
 
-FCustomViewportClient::~FCustomViewportClient()
+const TArray<FSceneViewExtensionRef>& FCustomViewportClient::GetActiveViewExtensions(FViewport* InViewport)
 {
-	if (Viewport)
-	{
-		UE_LOG(LogTemp, Fatal, TEXT("Viewport != NULL in FCustomViewportClient destructor."));
-	}
+	const int32 RefreshFrames = CVarViewExtensionRefreshFrames.GetValueOnGameThread();
 
-	if (FSlateApplication::IsInitialized())
+	if (bViewExtensionsDirty || RefreshFrames <= 0 || GFrameCounter - ViewExtensionsGatherFrame >= (uint64)RefreshFrames)
 	{
-#if WITH_EDITOR
-		FSlateApplication::Get().OnWindowDPIScaleChanged().RemoveAll(this);
-#endif
+		FSceneViewExtensionContext ViewExtensionContext(InViewport);
+		ViewExtensionContext.bStereoEnabled = true;
+		CachedViewExtensions = GEngine->ViewExtensions->GatherActiveExtensions(ViewExtensionContext);
+
+		ViewExtensionsGatherFrame = GFrameCounter;
+		bViewExtensionsDirty = false;
 	}
+
+	return CachedViewExtensions;
 }
 
-bool FCustomViewportClient::ToggleRealtime()
+void FCustomViewportClient::AllocateViewState()
 {
-	SetRealtime(!bIsRealtime);
-	return bIsRealtime;
+	FSceneViewStateReference& ActiveViewState = GetActiveViewState();
+
+	if (ActiveViewState.GetReference() == nullptr)
+	{
+		FSceneInterface* Scene = GetScene();
+		ActiveViewState.Allocate(Scene ? Scene->GetFeatureLevel() : GMaxRHIFeatureLevel);
+	}
 }
 
 float FCustomViewportClient::GetOrthoUnitsPerPixel(const FViewport* InViewport) const
@@ -658,6 +4724,8 @@ void FCustomViewportClient::SetInitialViewTransform(ECustomViewportType InViewpo
 
 FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, const int32 StereoViewIndex)
 {
+	VIEWPORTWIDGET_SCOPE(CalcSceneView);
+
 	const bool bStereoRendering = StereoViewIndex != INDEX_NONE;
 
 	FSceneViewInitOptions ViewInitOptions;
@@ -666,23 +4734,22 @@ FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, c
 	const ECustomViewportType EffectiveViewportType = GetViewportType();
 
 	// Apply view modifiers.
-	FCustomViewportViewModifierParams ViewModifierParams;
 	{
-		ViewModifierParams.ViewInfo.Location = ViewTransform.GetLocation();
-		ViewModifierParams.ViewInfo.Rotation = ViewTransform.GetRotation();
+		ViewModifierParams->ViewInfo.Location = ViewTransform.GetLocation();
+		ViewModifierParams->ViewInfo.Rotation = ViewTransform.GetRotation();
 
-		ViewModifierParams.ViewInfo.FOV = ViewFOV;
+		ViewModifierParams->ViewInfo.FOV = ViewFOV;
 	}
-	const FVector ModifiedViewLocation = ViewModifierParams.ViewInfo.Location;
-	FRotator ModifiedViewRotation = ViewModifierParams.ViewInfo.Rotation;
-	const float ModifiedViewFOV = ViewModifierParams.ViewInfo.FOV;
+	const FVector ModifiedViewLocation = ViewModifierParams->ViewInfo.Location;
+	FRotator ModifiedViewRotation = ViewModifierParams->ViewInfo.Rotation;
+	const float ModifiedViewFOV = ViewModifierParams->ViewInfo.FOV;
 
 	ViewInitOptions.ViewOrigin = ModifiedViewLocation;
 
-	FIntPoint ViewportSize = Viewport->GetSizeXY();
+	FIntPoint ViewportSize = ViewRectSize.X > 0 ? ViewRectSize : Viewport->GetSizeXY();
 	ViewportSize.X = FMath::Max(ViewportSize.X, 1);
 	ViewportSize.Y = FMath::Max(ViewportSize.Y, 1);
-	FIntPoint ViewportOffset(0, 0);
+	FIntPoint ViewportOffset = ViewRectOffset;
 
 	ViewInitOptions.SetViewRectangle(FIntRect(ViewportOffset, ViewportOffset + ViewportSize));
 
@@ -698,6 +4765,22 @@ FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, c
 		ViewInitOptions.WorldToMetersScale = WorldSettings->WorldToMeters;
 	}
 
+	FViewSetupKey ViewSetupKey;
+	ViewSetupKey.ViewRotation = ModifiedViewRotation;
+	ViewSetupKey.ViewportSize = ViewportSize;
+	ViewSetupKey.FOV = ModifiedViewFOV;
+	ViewSetupKey.NearPlane = GetNearClipPlane();
+	ViewSetupKey.ViewportType = EffectiveViewportType;
+
+	FCachedViewSetup& ActiveCachedViewSetup = GetActiveCachedViewSetup();
+
+	if (!bStereoRendering && ActiveCachedViewSetup.bValid && ActiveCachedViewSetup.Key == ViewSetupKey)
+	{
+		// Nothing the matrices depend on has changed since the last draw
+		ViewInitOptions.ViewRotationMatrix = ActiveCachedViewSetup.ViewRotationMatrix;
+		ViewInitOptions.ProjectionMatrix = ActiveCachedViewSetup.ProjectionMatrix;
+	}
+	else
 	{
 		//
 		if (EffectiveViewportType == ECustomViewportType::CVT_Perspective)
@@ -795,67 +4878,7 @@ FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, c
 			float OrthoWidth = Zoom * ViewportSize.X / 2.0f;
 			float OrthoHeight = Zoom * ViewportSize.Y / 2.0f;
 
-			if (EffectiveViewportType == ECustomViewportType::CVT_OrthoXY)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(1, 0, 0, 0),
-					FPlane(0, -1, 0, 0),
-					FPlane(0, 0, -1, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoXZ)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(1, 0, 0, 0),
-					FPlane(0, 0, -1, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoYZ)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(0, 0, 1, 0),
-					FPlane(1, 0, 0, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeXY)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(-1, 0, 0, 0),
-					FPlane(0, -1, 0, 0),
-					FPlane(0, 0, 1, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeXZ)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(-1, 0, 0, 0),
-					FPlane(0, 0, 1, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeYZ)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(0, 0, -1, 0),
-					FPlane(-1, 0, 0, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoFreelook)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(0, 0, 1, 0),
-					FPlane(1, 0, 0, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else
-			{
-				// Unknown viewport type
-				check(false);
-			}
+			ViewInitOptions.ViewRotationMatrix = GetOrthoViewRotationMatrix(EffectiveViewportType);
 
 			ViewInitOptions.ProjectionMatrix = FReversedZOrthoMatrix(
 				OrthoWidth,
@@ -864,6 +4887,14 @@ FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, c
 				ZOffset
 			);
 		}
+
+		if (!bStereoRendering)
+		{
+			ActiveCachedViewSetup.Key = ViewSetupKey;
+			ActiveCachedViewSetup.ViewRotationMatrix = ViewInitOptions.ViewRotationMatrix;
+			ActiveCachedViewSetup.ProjectionMatrix = ViewInitOptions.ProjectionMatrix;
+			ActiveCachedViewSetup.bValid = true;
+		}
 	}
 
 	if (!ViewInitOptions.IsValidViewRectangle())
@@ -872,6 +4903,9 @@ FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, c
 		ViewInitOptions.SetViewRectangle(FIntRect(0, 0, 1, 1));
 	}
 
+	// The main view state may have been released while the viewport was hidden
+	AllocateViewState();
+
 	// Allocate our stereo view state on demand, so that only viewports that actually use stereo features have one
 	const int32 ViewStateIndex = (StereoViewIndex != INDEX_NONE) ? StereoViewIndex : 0;
 	if (bStereoRendering)
@@ -889,7 +4923,7 @@ FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, c
 	}
 
 	ViewInitOptions.ViewFamily = ViewFamily;
-	ViewInitOptions.SceneViewStateInterface = ((ViewStateIndex == 0) ? ViewState.GetReference() : StereoViewStates[ViewStateIndex].GetReference());
+	ViewInitOptions.SceneViewStateInterface = ((ViewStateIndex == 0) ? GetActiveViewState().GetReference() : StereoViewStates[ViewStateIndex].GetReference());
 	ViewInitOptions.StereoViewIndex = StereoViewIndex;
 
 	ViewInitOptions.BackgroundColor = GetBackgroundColor();
@@ -910,22 +4944,56 @@ FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, c
 	int32 FamilyIndex = ViewFamily->Views.Add(View);
 	check(FamilyIndex == View->StereoViewIndex || View->StereoViewIndex == INDEX_NONE);
 
-	View->StartFinalPostprocessSettings(View->ViewLocation);
+	const bool bPostProcessing = ViewFamily->EngineShowFlags.PostProcessing != 0;
+
+	const uint32 VolumeSignature = ViewportWidgetPostProcess_NM::CalcVolumeSignature(GetWorld());
+	FCachedPostProcess& ActiveCachedPostProcess = GetActiveCachedPostProcess();
 
+	if (!bStereoRendering && ActiveCachedPostProcess.bValid && ActiveCachedPostProcess.Location == View->ViewLocation
+		&& ActiveCachedPostProcess.bPostProcessing == bPostProcessing && ActiveCachedPostProcess.VolumeSignature == VolumeSignature)
+	{
+		// Reuse the resolved volume blend, only let the view state know post processing starts
+		if (View->State)
+		{
+			View->State->OnStartPostProcessing(*View);
+		}
+
+		View->FinalPostProcessSettings = ActiveCachedPostProcess.Settings;
+	}
+	else
+	{
+		View->StartFinalPostprocessSettings(View->ViewLocation);
+
+		if (!bStereoRendering)
+		{
+			ActiveCachedPostProcess.Settings = View->FinalPostProcessSettings;
+			ActiveCachedPostProcess.Location = View->ViewLocation;
+			ActiveCachedPostProcess.VolumeSignature = VolumeSignature;
+			ActiveCachedPostProcess.bPostProcessing = bPostProcessing;
+			ActiveCachedPostProcess.bValid = true;
+		}
+	}
+
+	// Blended every frame on top of the volumes, subclasses and view modifiers may change them at any time
 	OverridePostProcessSettings(*View);
 
-	if (ViewModifierParams.ViewInfo.PostProcessBlendWeight > 0.f)
+	if (ViewModifierParams->ViewInfo.PostProcessBlendWeight > 0.f)
 	{
-		View->OverridePostProcessSettings(ViewModifierParams.ViewInfo.PostProcessSettings, ViewModifierParams.ViewInfo.PostProcessBlendWeight);
+		View->OverridePostProcessSettings(ViewModifierParams->ViewInfo.PostProcessSettings, ViewModifierParams->ViewInfo.PostProcessBlendWeight);
 	}
-	const int32 PPNum = FMath::Min(ViewModifierParams.PostProcessSettings.Num(), ViewModifierParams.PostProcessBlendWeights.Num());
+	const int32 PPNum = FMath::Min(ViewModifierParams->PostProcessSettings.Num(), ViewModifierParams->PostProcessBlendWeights.Num());
 	for (int32 PPIndex = 0; PPIndex < PPNum; ++PPIndex)
 	{
-		const FPostProcessSettings& PPSettings = ViewModifierParams.PostProcessSettings[PPIndex];
-		const float PPWeight = ViewModifierParams.PostProcessBlendWeights[PPIndex];
+		const FPostProcessSettings& PPSettings = ViewModifierParams->PostProcessSettings[PPIndex];
+		const float PPWeight = ViewModifierParams->PostProcessBlendWeights[PPIndex];
 		View->OverridePostProcessSettings(PPSettings, PPWeight);
 	}
 
+	if (PostProcessLayers.IsValid())
+	{
+		PostProcessLayers->ApplyTo(*View);
+	}
+
 	View->EndFinalPostprocessSettings(ViewInitOptions);
 
 	for (int ViewExt = 0; ViewExt < ViewFamily->ViewExtensions.Num(); ViewExt++)
@@ -954,6 +5022,8 @@ void FCustomViewportClient::SetViewportType(ECustomViewportType InViewportType)
 {
 	ViewportType = InViewportType;
 
+	InvalidateCachedViewSetup();
+
 	// Changing the type may also change the active view mode; re-apply that now
 	ApplyViewMode(GetViewMode(), IsPerspective(), EngineShowFlags);
 
@@ -967,6 +5037,8 @@ void FCustomViewportClient::RotateViewportType()
 {
 	ViewportType = ViewOptions[ViewOptionIndex];
 
+	InvalidateCachedViewSetup();
+
 	// Changing the type may also change the active view mode; re-apply that now
 	ApplyViewMode(GetViewMode(), IsPerspective(), EngineShowFlags);
 
@@ -975,14 +5047,7 @@ void FCustomViewportClient::RotateViewportType()
 
 	Invalidate();
 
-	if (ViewOptionIndex == 5)
-	{
-		ViewOptionIndex = 0;
-	}
-	else
-	{
-		ViewOptionIndex++;
-	}
+	ViewOptionIndex = (ViewOptionIndex + 1) % (int32)UE_ARRAY_COUNT(ViewOptions);
 }
 
 bool FCustomViewportClient::IsActiveViewportTypeInRotation() const { return GetViewportType() == ViewOptions[ViewOptionIndex]; }
@@ -1034,6 +5099,7 @@ void FCustomViewportClient::UpdateLightingShowFlags(FEngineShowFlags& InOutShowF
 void FCustomViewportClient::HandleWindowDPIScaleChanged(TSharedRef<SWindow> InWindow)
 {
 	RequestUpdateDPIScale();
+	InvalidateCachedViewSetup();
 	Invalidate();
 }
 
@@ -1042,6 +5108,8 @@ void FCustomViewportClient::HandleToggleShowFlag(FEngineShowFlags::EShowFlag Eng
 	const bool bOldState = EngineShowFlags.GetSingleFlag(EngineShowFlagIndex);
 	EngineShowFlags.SetSingleFlag(EngineShowFlagIndex, !bOldState);
 
+	InvalidateCachedPostProcess();
+
 	// Invalidate clients which aren't real-time so we see the changes.
 	Invalidate();
 }
@@ -1294,10 +5362,7 @@ FString FCustomViewportClient::UnrealUnitsToSiUnits(float UnrealUnits)
 
 void FCustomViewportClient::AddReferencedObjects(FReferenceCollector& Collector)
 {
-	if (PreviewScene)
-	{
-		PreviewScene->AddReferencedObjects(Collector);
-	}
+	// The preview scene is a GC object of its own, reporting its world and components here too only made every GC walk them twice
 
 	if (ViewState.GetReference())
 	{
@@ -1311,6 +5376,19 @@ void FCustomViewportClient::AddReferencedObjects(FReferenceCollector& Collector)
 			StereoViewState.GetReference()->AddReferencedObjects(Collector);
 		}
 	}
+
+	for (FCustomViewportPane& Pane : Panes)
+	{
+		if (Pane.ViewState.GetReference())
+		{
+			Pane.ViewState.GetReference()->AddReferencedObjects(Collector);
+		}
+	}
+
+	if (PostProcessLayers.IsValid())
+	{
+		PostProcessLayers->AddReferencedObjects(Collector);
+	}
 }
 
 FSceneInterface* FCustomViewportClient::GetScene() const
@@ -1389,11 +5467,8 @@ void FCustomViewportClient::SetupViewForRendering(FSceneViewFamily& ViewFamily,
 #endif
 }
 
-void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
+FSceneViewFamily::ConstructionValues FCustomViewportClient::MakeViewFamilyConstructionValues(const FRenderTarget* RenderTarget) const
 {
-	FViewport* ViewportBackup = Viewport;
-	Viewport = InViewport ? InViewport : Viewport;
-
 	UWorld* World = GetWorld();
 	FGameTime Time;
 	if (!World || (GetScene() != World->Scene) || UseAppTime())
@@ -1405,42 +5480,31 @@ void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
 		Time = World->GetTime();
 	}
 
-	// Early out if we are changing maps in editor as there is no reason to render the scene and it may not even be valid (For unsaved maps)
-	if (World && World->IsPreparingMapChange())
-	{
-		return;
-	}
-
-	// Allow HMD to modify the view later, just before rendering
-	const bool bStereoRendering = GEngine->IsStereoscopic3D(InViewport);
-	Canvas->SetScaledToRenderTarget(bStereoRendering);
-	Canvas->SetStereoRendering(bStereoRendering);
-
 	FEngineShowFlags UseEngineShowFlags = EngineShowFlags;
 	if (OverrideShowFlagsFunc)
 	{
 		OverrideShowFlagsFunc(UseEngineShowFlags);
 	}
 
-	// Setup a FSceneViewFamily/FSceneView for the viewport.
-	FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(
-		Canvas->GetRenderTarget(),
+	return FSceneViewFamily::ConstructionValues(
+		RenderTarget,
 		GetScene(),
 		UseEngineShowFlags)
 		.SetTime(Time)
 		.SetRealtimeUpdate(IsRealtime() && FSlateThrottleManager::Get().IsAllowingExpensiveTasks())
-		.SetViewModeParam(ViewModeParam, ViewModeParamName));
+		.SetViewModeParam(ViewModeParam, ViewModeParamName);
+}
 
+void FCustomViewportClient::SetupViewFamily(FSceneViewFamily& ViewFamily, FViewport* InViewport, bool bStereoRendering)
+{
 	ViewFamily.DebugDPIScale = GetDPIScale();
 
-	ViewFamily.EngineShowFlags = UseEngineShowFlags;
-
 	ViewFamily.bIsHDR = Viewport->IsHDRViewport();
 
 	// The view is in focus if it is currently in editing
 	ViewFamily.SetIsInFocus(false);
 
-	if (!UseEngineShowFlags.Game)
+	if (!ViewFamily.EngineShowFlags.Game)
 	{
 		// in the editor, disable camera motion blur and other rendering features that rely on the former frame
 		// unless the view port is cinematic controlled
@@ -1453,9 +5517,7 @@ void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
 		ViewFamily.EngineShowFlags.SetScreenPercentage(false);
 	}
 
-	FSceneViewExtensionContext ViewExtensionContext(InViewport);
-	ViewExtensionContext.bStereoEnabled = true;
-	ViewFamily.ViewExtensions = GEngine->ViewExtensions->GatherActiveExtensions(ViewExtensionContext);
+	ViewFamily.ViewExtensions = GetActiveViewExtensions(InViewport);
 
 	for (auto ViewExt : ViewFamily.ViewExtensions)
 	{
@@ -1478,71 +5540,71 @@ void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
 	ViewFamily.ExposureSettings = ExposureSettings;
 
 	ViewFamily.LandscapeLODOverride = LandscapeLODOverride;
+}
 
-	FSceneView* View = nullptr;
-
-	// Stereo rendering
-	const bool bStereoDeviceActive = bStereoRendering && GEngine->StereoRenderingDevice.IsValid();
-	int32 NumViews = bStereoRendering ? GEngine->StereoRenderingDevice->GetDesiredNumberOfViews(bStereoRendering) : 1;
-	for (int StereoViewIndex = 0; StereoViewIndex < NumViews; ++StereoViewIndex)
-	{
-		View = CalcSceneView(&ViewFamily, bStereoRendering ? StereoViewIndex : INDEX_NONE);
+FSceneView* FCustomViewportClient::AddView(FSceneViewFamily& ViewFamily, FViewport* InViewport, const int32 StereoViewIndex)
+{
+	FSceneView* View = CalcSceneView(&ViewFamily, StereoViewIndex);
 
-		SetupViewForRendering(ViewFamily, *View);
+	SetupViewForRendering(ViewFamily, *View);
 
-		FSlateRect SafeFrame;
-		View->CameraConstrainedViewRect = View->UnscaledViewRect;
+	FSlateRect SafeFrame;
+	View->CameraConstrainedViewRect = View->UnscaledViewRect;
 
-		const float SizeX = InViewport->GetSizeXY().X / GetDPIScale();
-		const float SizeY = InViewport->GetSizeXY().Y / GetDPIScale();
+	const float SizeX = InViewport->GetSizeXY().X / GetDPIScale();
+	const float SizeY = InViewport->GetSizeXY().Y / GetDPIScale();
 
-		SafeFrame = FSlateRect(0, 0, SizeX, SizeY);
+	SafeFrame = FSlateRect(0, 0, SizeX, SizeY);
 
-		if (World)
-		{
-			FWorldCachedViewInfo& WorldViewInfo = World->CachedViewInfoRenderedLastFrame.AddDefaulted_GetRef();
-			WorldViewInfo.ViewMatrix = View->ViewMatrices.GetViewMatrix();
-			WorldViewInfo.ProjectionMatrix = View->ViewMatrices.GetProjectionMatrix();
-			WorldViewInfo.ViewProjectionMatrix = View->ViewMatrices.GetViewProjectionMatrix();
-			WorldViewInfo.ViewToWorld = View->ViewMatrices.GetInvViewMatrix();
-			World->LastRenderTime = World->GetTimeSeconds();
-		}
+	if (UWorld* World = GetWorld())
+	{
+		FWorldCachedViewInfo& WorldViewInfo = World->CachedViewInfoRenderedLastFrame.AddDefaulted_GetRef();
+		WorldViewInfo.ViewMatrix = View->ViewMatrices.GetViewMatrix();
+		WorldViewInfo.ProjectionMatrix = View->ViewMatrices.GetProjectionMatrix();
+		WorldViewInfo.ViewProjectionMatrix = View->ViewMatrices.GetViewProjectionMatrix();
+		WorldViewInfo.ViewToWorld = View->ViewMatrices.GetInvViewMatrix();
+		World->LastRenderTime = World->GetTimeSeconds();
 	}
 
+	return View;
+}
+
+void FCustomViewportClient::FinishViewFamily(FSceneViewFamily& ViewFamily, bool bStereoRendering)
+{
+	// If a screen percentage interface was not set by one of the view extension, then set the legacy one.
+	if (ViewFamily.GetScreenPercentageInterface() == nullptr)
 	{
-		// If a screen percentage interface was not set by one of the view extension, then set the legacy one.
-		if (ViewFamily.GetScreenPercentageInterface() == nullptr)
-		{
-			float GlobalResolutionFraction = 1.0f;
+		float GlobalResolutionFraction = 1.0f;
 
-			// Apply preview resolution fraction. Supported in stereo for VR Editor Mode only
-			if ((!bStereoRendering) &&
-				SupportsPreviewResolutionFraction() && ViewFamily.SupportsScreenPercentage())
+		// Apply preview resolution fraction. Supported in stereo for VR Editor Mode only
+		if ((!bStereoRendering) &&
+			SupportsPreviewResolutionFraction() && ViewFamily.SupportsScreenPercentage())
+		{
+			if (PreviewResolutionFraction.IsSet())
 			{
-				if (PreviewResolutionFraction.IsSet())
-				{
-					GlobalResolutionFraction = PreviewResolutionFraction.GetValue();
-				}
-				else
-				{
-					GlobalResolutionFraction = GetDefaultPrimaryResolutionFractionTarget();
-				}
-
-				// Force screen percentage's engine show flag to be turned on for preview screen percentage.
-				ViewFamily.EngineShowFlags.ScreenPercentage = (GlobalResolutionFraction != 1.0);
+				GlobalResolutionFraction = PreviewResolutionFraction.GetValue();
+			}
+			else
+			{
+				GlobalResolutionFraction = GetDefaultPrimaryResolutionFractionTarget();
 			}
 
-			// In editor viewport, we ignore r.ScreenPercentage and FPostProcessSettings::ScreenPercentage by design.
-			ViewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(
-				ViewFamily, GlobalResolutionFraction));
+			// Force screen percentage's engine show flag to be turned on for preview screen percentage.
+			ViewFamily.EngineShowFlags.ScreenPercentage = (GlobalResolutionFraction != 1.0);
 		}
 
-		check(ViewFamily.GetScreenPercentageInterface() != nullptr);
+		// In editor viewport, we ignore r.ScreenPercentage and FPostProcessSettings::ScreenPercentage by design.
+		ViewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(
+			ViewFamily, GlobalResolutionFraction));
+
+		LastResolutionFraction = GlobalResolutionFraction;
 	}
 
-	// Draw the 3D scene
-	GetRendererModule().BeginRenderingViewFamily(Canvas, &ViewFamily);
+	check(ViewFamily.GetScreenPercentageInterface() != nullptr);
+}
 
+void FCustomViewportClient::FlushWorldLineBatchers(UWorld* World)
+{
 	// Remove temporary debug lines.
 	// Possibly a hack. Lines may get added without the scene being rendered etc.
 	if (World && World->LineBatcher != NULL && (World->LineBatcher->BatchedLines.Num() || World->LineBatcher->BatchedPoints.Num() || World->LineBatcher->BatchedMeshes.Num()))
@@ -1554,6 +5616,63 @@ void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
 	{
 		World->ForegroundLineBatcher->Flush();
 	}
+}
+
+void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
+{
+	VIEWPORTWIDGET_SCOPE(Draw);
+
+	FViewport* ViewportBackup = Viewport;
+	Viewport = InViewport ? InViewport : Viewport;
+
+	LastDrawTime = FPlatformTime::Seconds();
+
+	UWorld* World = GetWorld();
+
+	// Early out if we are changing maps in editor as there is no reason to render the scene and it may not even be valid (For unsaved maps)
+	if (World && World->IsPreparingMapChange())
+	{
+		return;
+	}
+
+	// Allow HMD to modify the view later, just before rendering
+	const bool bStereoRendering = GEngine->IsStereoscopic3D(InViewport);
+	Canvas->SetScaledToRenderTarget(bStereoRendering);
+	Canvas->SetStereoRendering(bStereoRendering);
+
+	// Setup a FSceneViewFamily/FSceneView for the viewport.
+	FSceneViewFamilyContext ViewFamily(MakeViewFamilyConstructionValues(Canvas->GetRenderTarget()));
+
+	SetupViewFamily(ViewFamily, InViewport, bStereoRendering);
+
+	// Stereo rendering
+	const bool bStereoDeviceActive = bStereoRendering && GEngine->StereoRenderingDevice.IsValid();
+	if (bStereoRendering)
+	{
+		int32 NumViews = GEngine->StereoRenderingDevice->GetDesiredNumberOfViews(bStereoRendering);
+		for (int StereoViewIndex = 0; StereoViewIndex < NumViews; ++StereoViewIndex)
+		{
+			AddView(ViewFamily, InViewport, StereoViewIndex);
+		}
+	}
+	else
+	{
+		AddPaneViews(ViewFamily, InViewport, FIntPoint::ZeroValue);
+	}
+
+	FinishViewFamily(ViewFamily, bStereoRendering);
+
+	// Draw the 3D scene
+	GetRendererModule().BeginRenderingViewFamily(Canvas, &ViewFamily);
+
+	LastDrawSetupSeconds = FPlatformTime::Seconds() - LastDrawTime;
+
+	FlushWorldLineBatchers(World);
+
+	if (ShouldDrawStatsOverlay())
+	{
+		DrawStatsOverlay(Canvas, FIntPoint::ZeroValue);
+	}
 
 	if (!IsRealtime())
 	{
@@ -1565,6 +5684,104 @@ void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
 	Viewport = ViewportBackup;
 }
 
+void FCustomViewportClient::DrawViewFamily(FCanvas* Canvas, TArrayView<FCustomViewportClient* const> Clients, TArrayView<const FIntPoint> ViewOffsets)
+{
+	check(Clients.Num() > 0 && Clients.Num() == ViewOffsets.Num());
+
+	VIEWPORTWIDGET_SCOPE(Draw);
+
+	// Family wide settings (show flags, view mode, time, screen percentage) come from the first viewport
+	FCustomViewportClient* PrimaryClient = Clients[0];
+	UWorld* World = PrimaryClient->GetWorld();
+
+	if (World && World->IsPreparingMapChange())
+	{
+		return;
+	}
+
+	Canvas->SetScaledToRenderTarget(false);
+	Canvas->SetStereoRendering(false);
+
+	FSceneViewFamilyContext ViewFamily(PrimaryClient->MakeViewFamilyConstructionValues(Canvas->GetRenderTarget()));
+
+	PrimaryClient->SetupViewFamily(ViewFamily, PrimaryClient->Viewport, false);
+
+	const double CurrentTime = FPlatformTime::Seconds();
+
+	for (int32 ClientIndex = 0; ClientIndex < Clients.Num(); ++ClientIndex)
+	{
+		FCustomViewportClient* Client = Clients[ClientIndex];
+		checkf(Client->GetScene() == ViewFamily.Scene, TEXT("Viewports drawn in one view family must share the scene"));
+
+		const double ViewStartTime = FPlatformTime::Seconds();
+
+		Client->AddPaneViews(ViewFamily, Client->Viewport, ViewOffsets[ClientIndex]);
+
+		Client->LastDrawTime = CurrentTime;
+		Client->LastDrawSetupSeconds = FPlatformTime::Seconds() - ViewStartTime;
+	}
+
+	PrimaryClient->FinishViewFamily(ViewFamily, false);
+
+	GetRendererModule().BeginRenderingViewFamily(Canvas, &ViewFamily);
+
+	FlushWorldLineBatchers(World);
+
+	for (int32 ClientIndex = 0; ClientIndex < Clients.Num(); ++ClientIndex)
+	{
+		// The family is rendered at the resolution fraction of the first viewport
+		Clients[ClientIndex]->LastResolutionFraction = PrimaryClient->LastResolutionFraction;
+
+		if (Clients[ClientIndex]->ShouldDrawStatsOverlay())
+		{
+			Clients[ClientIndex]->DrawStatsOverlay(Canvas, ViewOffsets[ClientIndex]);
+		}
+	}
+}
+
+bool FCustomViewportClient::ShouldDrawStatsOverlay() const
+{
+	return bShowStatsOverlay || CVarShowStatsOverlay.GetValueOnGameThread() != 0;
+}
+
+void FCustomViewportClient::DrawStatsOverlay(FCanvas* Canvas, const FIntPoint& Offset) const
+{
+	const UFont* Font = GEngine ? GEngine->GetTinyFont() : nullptr;
+	if (!Font)
+	{
+		return;
+	}
+
+	TArray<FString, TInlineAllocator<6>> Lines;
+
+	if (TSharedPtr<SViewportWidget> Widget = ViewportWidget.Pin())
+	{
+		Lines.Add(FString::Printf(TEXT("Tick %.2f ms  Draw setup %.2f ms"), Widget->GetLastTickMs(), GetLastDrawSetupMs()));
+		Lines.Add(FString::Printf(TEXT("Entries %d  Actors %d"), Widget->GetNumEntries(), Widget->GetNumSpawnedActors()));
+		Lines.Add(FString::Printf(TEXT("Skipped frames %d"), Widget->GetNumSkippedFrames()));
+	}
+	else
+	{
+		Lines.Add(FString::Printf(TEXT("Draw setup %.2f ms"), GetLastDrawSetupMs()));
+	}
+
+	Lines.Add(FString::Printf(TEXT("Resolution %.0f%%"), LastResolutionFraction * 100.f));
+
+	const double LastCaptureUpdateTime = PreviewScene ? PreviewScene->GetLastCaptureUpdateTime() : 0.0;
+	Lines.Add(LastCaptureUpdateTime > 0.0
+		? FString::Printf(TEXT("Captures updated %.1f s ago"), FPlatformTime::Seconds() - LastCaptureUpdateTime)
+		: FString(TEXT("Captures never updated")));
+
+	const int32 LineHeight = FMath::CeilToInt(Font->GetMaxCharHeight()) + 2;
+	int32 Y = Offset.Y + 4;
+
+	for (const FString& Line : Lines)
+	{
+		Canvas->DrawShadowedString(Offset.X + 4, Y, *Line, Font, FLinearColor::Yellow);
+		Y += LineHeight;
+	}
+}
+
 /** True if the window is maximized or floating */
 bool FCustomViewportClient::IsVisible() const
 {
@@ -1611,6 +5828,8 @@ void FCustomViewportClient::SetViewMode(EViewModeIndex InViewModeIndex)
 		ApplyViewMode(OrthoViewModeIndex, false, EngineShowFlags);
 	}
 
+	InvalidateCachedPostProcess();
+
 	Invalidate();
 }
 
@@ -1722,6 +5941,8 @@ void FCustomViewportClient::SetGameView(bool bGameViewEnable)
 
 	bInGameViewMode = bGameViewEnable;
 
+	InvalidateCachedViewSetup();
+
 	Invalidate();
 }
 
@@ -1746,10 +5967,70 @@ float FCustomViewportClient::UpdateViewportClientWindowDPIScale() const
 
 void FViewportWidgetModule::StartupModule()
 {
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FViewportWidgetModule::Tick), 1.0f);
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FViewportWidgetModule::OnEndFrame);
+
+	// Lets memreport include viewport widgets in any project the plugin is enabled in
+	TArray<FString> MemReportCommands;
+	GConfig->GetArray(TEXT("MemReportCommands"), TEXT("Cmd"), MemReportCommands, GEngineIni);
+	if (!MemReportCommands.Contains(TEXT("ViewportWidget.MemReport")))
+	{
+		MemReportCommands.Add(TEXT("ViewportWidget.MemReport"));
+		GConfig->SetArray(TEXT("MemReportCommands"), TEXT("Cmd"), MemReportCommands, GEngineIni);
+	}
 }
 
 void FViewportWidgetModule::ShutdownModule()
 {
+	FCustomPreviewScene::FlushTeardownQueue();
+
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+}
+
+void FViewportWidgetModule::OnEndFrame()
+{
+	FCustomPreviewScene::TickTeardownQueue();
+
+	CSV_CUSTOM_STAT(ViewportWidget, LiveWidgets, FViewportWidgetStats::NumLiveWidgets, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ViewportWidget, SpawnedActors, FViewportWidgetStats::NumSpawnedActors, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ViewportWidget, PreviewWorlds, FViewportWidgetStats::NumPreviewWorlds, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ViewportWidget, PSOPrecacheHits, FViewportWidgetStats::NumPSOPrecacheHits, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ViewportWidget, PSOPrecacheMisses, FViewportWidgetStats::NumPSOPrecacheMisses, ECsvCustomStatOp::Set);
+}
+
+bool FViewportWidgetModule::Tick(float DeltaTime)
+{
+	VIEWPORTWIDGET_SCOPE(Housekeeping);
+
+	const double CurrentTime = FPlatformTime::Seconds();
+
+	for (FCustomViewportClient* Client : FCustomViewportClient::GetLiveClients())
+	{
+		Client->ReleaseViewStatesIfHidden(CurrentTime);
+	}
+
+	FViewportRenderTargetPool::Get().Trim(CVarRenderTargetPoolIdleTime.GetValueOnGameThread());
+
+	const float MemoryBudgetMB = CVarMemoryBudget.GetValueOnGameThread();
+
+	if (MemoryBudgetMB > 0.f && CurrentTime - LastMemoryBudgetCheckTime >= CVarMemoryBudgetCheckInterval.GetValueOnGameThread())
+	{
+		LastMemoryBudgetCheckTime = CurrentTime;
+
+		const SIZE_T TotalBytes = SViewportWidget::GetTotalMemoryUsage().GetTotalBytes();
+		const bool bOverBudget = TotalBytes > MemoryBudgetMB * 1024.f * 1024.f;
+
+		// Warn once per crossing, not on every check
+		if (bOverBudget && !bMemoryBudgetExceeded)
+		{
+			UE_LOG(LogViewportWidget, Warning, TEXT("Viewport widgets hold %.2f MB, over the budget of %.2f MB, see ViewportWidget.MemReport"), TotalBytes / 1024.f / 1024.f, MemoryBudgetMB);
+		}
+
+		bMemoryBudgetExceeded = bOverBudget;
+	}
+
+	return true;
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -4,6 +4,8 @@
 
 #include "Components/Widget.h"
 #include "Widgets/SViewportWidget.h"
+#include "ViewportWidgetPostProcessAsset.h"
+#include "Containers/Ticker.h"
 #include "ViewportWidget.generated.h"
 
 //------------------------------------------------------
@@ -19,8 +21,14 @@ public:
 	//~ UWidget interface
 	virtual void SynchronizeProperties() override;
 	virtual void ReleaseSlateResources(bool bReleaseChildren) override;
+	virtual void RemoveFromParent() override;
 	//~ End of UVisual interface
 
+	//~ UObject interface
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+	virtual void BeginDestroy() override;
+	//~ End of UObject interface
+
 #if WITH_EDITOR
 	virtual const FText GetPaletteCategory() override;
 #endif
@@ -37,9 +45,90 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void SetEntries(const TArray<FViewportWidgetEntry>& entries);
 
+	/**
+	 * Shows other entries and moves the view, reusing the preview world and as many spawned actors as possible.
+	 * Meant for list view entries being recycled for another item, see UViewportWidgetListEntry.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void RetargetEntries(const TArray<FViewportWidgetEntry>& entries, FTransform viewTransform);
+
+	/**
+	 * Shows other entries without an empty frame in between: the new ones are loaded and spawned hidden over several frames,
+	 * swapped in at once and the old ones released after the first frame showing the new ones was rendered.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SwapEntries(const TArray<FViewportWidgetEntry>& entries);
+
+	UFUNCTION(BlueprintCallable)
+	bool IsSwapPending() const;
+
+	/**
+	 * Loads the classes of entries likely shown next and keeps them loaded, so setting them later doesn't load anything.
+	 * With preSpawnActors, dormant actors are also spawned into the actor pool a few per frame, so setting them spawns nothing either.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void PrefetchEntries(const TArray<FViewportWidgetEntry>& entries, bool preSpawnActors = false);
+
 	UFUNCTION(BlueprintCallable)
 	AActor* GetSpawnedActor(const int32 entryIndex) const;
 
+	UFUNCTION(BlueprintCallable)
+	EViewportWidgetRenderMode GetRenderMode() const { return RenderMode; }
+
+	UFUNCTION(BlueprintCallable)
+	void SetRenderMode(EViewportWidgetRenderMode renderMode, float scheduledRedrawInterval = 1.f);
+
+	/** Redraws the preview on next tick in on demand and scheduled render modes */
+	UFUNCTION(BlueprintCallable)
+	void RequestRedraw();
+
+	/** Uses the layers of the asset, the layer set is shared with every widget using the same asset and blended into each view every frame */
+	UFUNCTION(BlueprintCallable)
+	void SetPostProcessAsset(UViewportWidgetPostProcessAsset* postProcessAsset);
+
+	/** Uses layers private to this widget, blended into each view every frame like asset layers */
+	UFUNCTION(BlueprintCallable)
+	void SetPostProcessLayers(const TArray<FViewportWidgetPostProcessLayer>& postProcessLayers);
+
+	/**
+	 * Shows the preview scene of the source widget instead of a scene of its own, e.g. to look at the same item from several angles.
+	 * The scene is ticked once and all widgets sharing it are rendered in one pass, entries of every widget are visible in all of them.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void ShareSceneWith(UViewportWidget* source);
+
+	/** Goes back to a preview scene of its own */
+	UFUNCTION(BlueprintCallable)
+	void StopSharingScene();
+
+	UFUNCTION(BlueprintCallable)
+	EViewportWidgetLayout GetLayout() const { return Layout; }
+
+	/** Splits the preview into panes, all of them are rendered in one pass over one world tick */
+	UFUNCTION(BlueprintCallable)
+	void SetLayout(EViewportWidgetLayout layout);
+
+	UFUNCTION(BlueprintCallable)
+	const TArray<FViewportWidgetPane>& GetPanes() const { return Panes; }
+
+	UFUNCTION(BlueprintCallable)
+	void SetPanes(const TArray<FViewportWidgetPane>& panes);
+
+	UFUNCTION(BlueprintCallable)
+	void SetShowStatsOverlay(bool showStatsOverlay);
+
+	/** Only the first entry of each class and anim instance evaluates its anim graph, the others follow its pose */
+	UFUNCTION(BlueprintCallable)
+	void SetSharePoses(bool sharePoses);
+
+	/** Measures tick time, component, primitive and bone counts and estimated render cost of every spawned entry, tick time needs ViewportWidget.TrackEntryCosts */
+	UFUNCTION(BlueprintCallable)
+	TArray<FViewportWidgetEntryCost> GetEntryCosts() const;
+
+	/** Entry costs summed up by entry class, most expensive tick first */
+	UFUNCTION(BlueprintCallable)
+	TArray<FViewportWidgetEntryCost> GetClassCosts() const;
+
 protected:
 	//~ UWidget interface
 	virtual TSharedRef<SWidget> RebuildWidget() override;
@@ -53,4 +142,71 @@ protected:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<FViewportWidgetEntry> Entries;
+
+	/** Seconds the hidden preview keeps its scene view states, 0 keeps them forever, negative uses ViewportWidget.ViewStateReleaseDelay */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, AdvancedDisplay)
+	float ViewStateReleaseDelay = -1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	EViewportWidgetRenderMode RenderMode = EViewportWidgetRenderMode::Realtime;
+
+	/** Seconds between redraws in scheduled render mode */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "0.0"))
+	float ScheduledRedrawInterval = 1.f;
+
+	/** Non realtime previews borrow a shared render target while drawing and only keep a cached copy of the final color */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, AdvancedDisplay)
+	bool bUsePooledRenderTarget = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TObjectPtr<UViewportWidgetPostProcessAsset> PostProcessAsset;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	EViewportWidgetLayout Layout = EViewportWidgetLayout::OnePane;
+
+	/** Views of the second and further panes, the first pane shows ViewTransform */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TArray<FViewportWidgetPane> Panes;
+
+	/** Draws tick and draw times, entry counts and other performance info inside the preview */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, AdvancedDisplay)
+	bool bShowStatsOverlay = false;
+
+	/**
+	 * Entries without a LeaderEntryIndex follow the skeletal mesh pose of the first entry of the same class and anim instance,
+	 * so crowds playing the same animation evaluate one anim graph per group
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, AdvancedDisplay)
+	bool bSharePoses = false;
+
+	/** Spreads creating the preview world over several frames so opening screens with many previews doesn't hitch */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, AdvancedDisplay)
+	bool bStagedInitialization = false;
+
+	/**
+	 * Keeps the preview world, view state and spawned entries when the Slate widget is released, e.g. on visibility changes
+	 * or list view recycling, so rebuilding the widget doesn't spawn everything again. Dropped on RemoveFromParent or when
+	 * no rebuild follows within ViewportWidget.PreservedStateTimeout seconds
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, AdvancedDisplay)
+	bool bPreservePreviewAcrossRebuilds = false;
+
+	/** Shown until the preview world is ready */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, AdvancedDisplay, meta = (EditCondition = "bStagedInitialization"))
+	FSlateBrush PlaceholderBrush;
+
+	/** Layers set through SetPostProcessLayers, take precedence over PostProcessAsset. Their objects are reported by AddReferencedObjects */
+	TSharedPtr<const FCustomViewportPostProcessLayers> PostProcessLayers;
+
+	TSharedPtr<const FCustomViewportPostProcessLayers> GetEffectivePostProcessLayers() const;
+
+	TSharedPtr<FCustomViewportGroup> ViewportGroup;
+
+	/** State of the released Slate widget, picked up by the next RebuildWidget */
+	TSharedPtr<FViewportWidgetPreservedState> PreservedState;
+
+	FTSTicker::FDelegateHandle PreservedStateTimeoutHandle;
+
+	/** Drops the preserved state and its timeout */
+	void ReleasePreservedState();
 };
\ No newline at end of file
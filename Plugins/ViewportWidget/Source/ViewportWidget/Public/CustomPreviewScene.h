@@ -19,13 +19,39 @@ public:
 			, bForceMipsResident(true)
 			, bTransactional(true)
 			, bForceUseMovementComponentInNonGameWorld(false)
+			, bCreateGCCluster(false)
+			, bCreateFXSystem(true)
+			, bCreateLineBatcher(true)
+			, bStagedInitialization(false)
 		{}
 
+		/**
+		 * Profile for previews created in bulk: no FX system, line batcher, audio, game mode, transactional objects or forced mip residency.
+		 * World subsystems can't be filtered without engine changes, they're still created as for any game preview world.
+		 */
+		static ConstructionValues Minimal()
+		{
+			return ConstructionValues()
+				.AllowAudioPlayback(false)
+				.SetForceMipsResident(false)
+				.SetTransactional(false)
+				.SetCreateFXSystem(false)
+				.SetCreateLineBatcher(false);
+		}
+
 		uint32 bDefaultLighting : 1;
 		uint32 bAllowAudioPlayback : 1;
 		uint32 bForceMipsResident : 1;
 		uint32 bTransactional : 1;
 		uint32 bForceUseMovementComponentInNonGameWorld : 1;
+		/** Puts spawned actors and their components into one GC cluster, so reachability analysis doesn't walk them one by one */
+		uint32 bCreateGCCluster : 1;
+		/** Niagara and Cascade entries need the FX system */
+		uint32 bCreateFXSystem : 1;
+		/** Created only with default lighting */
+		uint32 bCreateLineBatcher : 1;
+		/** Spreads world creation over several frames under ViewportWidget.InitBudgetMs, see AdvanceInitialization */
+		uint32 bStagedInitialization : 1;
 
 		TSubclassOf<class AGameModeBase> DefaultGameMode;
 		class UGameInstance* OwningGameInstance = nullptr;
@@ -35,6 +61,10 @@ public:
 		ConstructionValues& AllowAudioPlayback(const bool bAllow) { bAllowAudioPlayback = bAllow; return *this; }
 		ConstructionValues& SetForceMipsResident(const bool bForce) { bForceMipsResident = bForce; return *this; }
 		ConstructionValues& SetTransactional(const bool bInTransactional) { bTransactional = bInTransactional; return *this; }
+		ConstructionValues& SetCreateGCCluster(const bool bCreate) { bCreateGCCluster = bCreate; return *this; }
+		ConstructionValues& SetCreateFXSystem(const bool bCreate) { bCreateFXSystem = bCreate; return *this; }
+		ConstructionValues& SetCreateLineBatcher(const bool bCreate) { bCreateLineBatcher = bCreate; return *this; }
+		ConstructionValues& SetStagedInitialization(const bool bStaged) { bStagedInitialization = bStaged; return *this; }
 		ConstructionValues& ForceUseMovementComponentInNonGameWorld(const bool bInForceUseMovementComponentInNonGameWorld) { bForceUseMovementComponentInNonGameWorld = bInForceUseMovementComponentInNonGameWorld; return *this; }
 
 		ConstructionValues& SetDefaultGameMode(TSubclassOf<class AGameModeBase> GameMode) { DefaultGameMode = GameMode; return *this; }
@@ -59,9 +89,21 @@ public:
 	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
 	virtual FString GetReferencerName() const override;
 
+	/** @return True once the world is fully initialized, always true unless initialization is staged */
+	bool IsReady() const { return InitStage == EInitStage::Ready; }
+
+	/**
+	 * Runs further initialization stages while the per frame budget shared by all staged scenes lasts,
+	 * the first stage of a frame always runs so every scene makes progress.
+	 *
+	 * @return True once the world is ready
+	 */
+	bool AdvanceInitialization();
+
 	// Accessors.
-	UWorld* GetWorld() const { return PreviewWorld; }
-	FSceneInterface* GetScene() const { return PreviewWorld->Scene; }
+	/** @return The world, null until it is ready */
+	UWorld* GetWorld() const { return IsReady() ? PreviewWorld : nullptr; }
+	FSceneInterface* GetScene() const { return IsReady() ? PreviewWorld->Scene : nullptr; }
 
 	/** Access to line drawing */
 	class ULineBatchComponent* GetLineBatcher() const { return LineBatcher; }
@@ -71,13 +113,164 @@ public:
 	/** Update sky and reflection captures */
 	void UpdateCaptureContents();
 
+	/** @return Time of the last UpdateCaptureContents call, zero if never updated */
+	double GetLastCaptureUpdateTime() const { return LastCaptureUpdateTime; }
+
+	/** @return Flags for objects spawned into the scene, transactional only in the editor */
+	EObjectFlags GetSpawnObjectFlags() const;
+
+	/** Rebuilds the GC cluster from the static actors currently in the world, call after spawning. Does nothing unless enabled by ConstructionValues */
+	void CreateGCCluster();
+
+	/** Dissolves the GC cluster, call before destroying clustered actors */
+	void DissolveGCCluster();
+
+	bool HasGCCluster() const { return GCClusterRoot != nullptr; }
+
+	/** @return Number of world subsystems created for the preview world */
+	int32 GetNumWorldSubsystems() const;
+
+	/**
+	 * Deleter for shared pointers to scenes. Stops audio and removes primitives from the renderer and texture streaming right away and queues the scene,
+	 * whose components and actors are then unregistered and world cleaned up over later frames under ViewportWidget.TeardownBudgetMs,
+	 * unless ViewportWidget.DeferredTeardown is 0.
+	 */
+	static void DeferredDelete(FCustomPreviewScene* PreviewScene);
+
+	/** Advances queued teardowns under the per frame budget, called once per frame by the module */
+	static void TickTeardownQueue();
+
+	/** Finishes all queued teardowns right away, e.g. on shutdown or before measuring memory */
+	static void FlushTeardownQueue();
+
+	static int32 GetNumQueuedTeardowns();
+
+	/**
+	 * Hides the actor and keeps it to be handed out again by AcquirePooledActor, e.g. when a recycled widget shows other entries.
+	 *
+	 * @return False if the pool of the actor's class is full, the caller destroys the actor then
+	 */
+	bool ReleaseActorToPool(class AActor* Actor);
+
+	/** @return Pooled actor of exactly ActorClass moved to Transform and shown again, null if none is pooled */
+	class AActor* AcquirePooledActor(UClass* ActorClass, const FTransform& Transform);
+
+	int32 GetNumPooledActors() const;
+
+	int32 GetNumPooledActors(UClass* ActorClass) const;
+
+	/** Hides or shows the actor in game and editor views */
+	static void SetActorHiddenInPreview(class AActor* Actor, bool bHidden);
+
+	/** Destroys all pooled actors */
+	void EmptyActorPool();
+
+	/** @return UObject and render resource bytes of the world and everything in it, expensive as all objects are serialized */
+	struct FViewportWidgetMemoryUsage GetMemoryUsage() const;
+
+	struct FTextureStreamingStats
+	{
+		/** Textures currently primed by PrimeTextures */
+		int32 NumPrimingTextures = 0;
+		int64 PrimingBytes = 0;
+
+		/** Textures left to regular streaming as priming them would have exceeded ViewportWidget.TexturePrimeBudgetMB */
+		int32 NumOverBudget = 0;
+
+		/** Resident mips of all textures used in the world */
+		int64 ResidentBytes = 0;
+	};
+
+	/**
+	 * Adds a boosted streaming view on the actor lasting ViewportWidget.TexturePrimeSeconds, so its textures don't stream in blurry
+	 * over several frames. Actors whose textures would exceed the world's priming budget are left to regular streaming.
+	 * Does nothing if all used mips are kept resident anyway or ScreenSize, the width of the view in pixels, isn't known yet.
+	 */
+	void PrimeTextures(class AActor* Actor, float ScreenSize);
+
+	/** Stops counting primed textures that are streamed in or ran out of time against the budget */
+	void TickTexturePriming();
+
+	/** @return Texture streaming numbers of the world, expensive as the used textures of every primitive are gathered */
+	FTextureStreamingStats GetTextureStreamingStats() const;
+
 private:
+	enum class EInitStage : uint8
+	{
+		CreateWorld,
+		InitializeWorld,
+		InitializeActorsForPlay,
+		CreateLineBatcher,
+		Ready
+	};
+
+	void RunInitStage();
+
+	enum class ETeardownStage : uint8
+	{
+		UnregisterComponents,
+		UnregisterActors,
+		CleanupWorld,
+		Done
+	};
+
+	/** Runs one step of the teardown, e.g. unregisters one component */
+	void RunTeardownStep();
+
+	/** Stops audio, the first part of the teardown which can't wait */
+	void FlushAudio();
+
+	/** Removes all primitives from the render scene and texture streaming, so a queued scene costs neither before it is unregistered */
+	void RemoveFromRenderingAndStreaming();
+
 	TArray<class UActorComponent*> Components;
 
+	/** Kept until the world is ready, later stages need them */
+	ConstructionValues InitValues;
+
+	EInitStage InitStage;
+
+	ETeardownStage TeardownStage;
+
+	/** Next actor of the persistent level to unregister during teardown */
+	int32 TeardownActorIndex;
+
+	/** Hidden actors by class, kept alive by the level */
+	TMap<UClass*, TArray<class AActor*>> ActorPool;
+
+	/** Collision and tick state an actor had when it was pooled, restored when it is handed out again */
+	struct FPooledActorState
+	{
+		bool bCollisionEnabled = true;
+
+		bool bTickEnabled = false;
+
+		/** Components whose tick was enabled */
+		TArray<TWeakObjectPtr<class UActorComponent>> TickingComponents;
+	};
+
+	TMap<class AActor*, FPooledActorState> PooledActorStates;
+
+	/** Textures primed by PrimeTextures, with the time they were primed */
+	TArray<TPair<TWeakObjectPtr<class UTexture>, double>> PrimingTextures;
+
+	int64 PrimingBytes = 0;
+
+	int32 NumTexturesOverBudget = 0;
+
 protected:
 	class UWorld* PreviewWorld = nullptr;
 	class ULineBatchComponent* LineBatcher = nullptr;
 
+	/** Root of the cluster holding spawned actors, null if not clustered */
+	class ULevelActorContainer* GCClusterRoot = nullptr;
+
+	bool bTransactional;
+
+	bool bCreateGCCluster;
+
 	/** This controls whether or not all mip levels of textures used by UMeshComponents added to this preview window should be loaded and remain loaded. */
 	bool bForceAllUsedMipsResident;
+
+	double LastCaptureUpdateTime = 0.0;
 };
\ No newline at end of file
@@ -3,9 +3,13 @@
 #pragma once
 
 #include "ViewportClient.h"
+#include "SceneView.h"
+#include "SceneViewExtension.h"
 
 class FCustomPreviewScene;
 class SViewportWidget;
+struct FCustomViewportViewModifierParams;
+class FCustomViewportPostProcessLayers;
 
 enum class ECustomViewportType :uint8;
 
@@ -83,6 +87,11 @@ public:
 	 */
 	FCustomPreviewScene* GetPreviewScene() { return PreviewScene; }
 
+	/**
+	 * Switches the viewport to another preview scene. View states are released as they hold history of the old scene.
+	 */
+	void SetPreviewScene(FCustomPreviewScene* InPreviewScene);
+
 	/**
 	 * Toggles whether or not the viewport updates in realtime and returns the updated state.
 	 * Note: This value is saved between editor sessions so it should not be used for temporary states.  For that see SetRealtimeOverride
@@ -100,10 +109,10 @@ public:
 	/** @return		True if viewport is in realtime mode, false otherwise. */
 	bool IsRealtime() const { return bIsRealtime; }
 
-	/** Gets ViewportCameraTransform object for the current viewport type */
-	FCustomViewportCameraTransform& GetViewTransform() { return IsPerspective() ? ViewTransformPerspective : ViewTransformOrthographic; }
+	/** Gets ViewportCameraTransform object for the current viewport type, or of the pane being drawn */
+	FCustomViewportCameraTransform& GetViewTransform() { return ActivePaneIndex > 0 ? Panes[ActivePaneIndex - 1].ViewTransform : IsPerspective() ? ViewTransformPerspective : ViewTransformOrthographic; }
 
-	const FCustomViewportCameraTransform& GetViewTransform() const { return IsPerspective() ? ViewTransformPerspective : ViewTransformOrthographic; }
+	const FCustomViewportCameraTransform& GetViewTransform() const { return ActivePaneIndex > 0 ? Panes[ActivePaneIndex - 1].ViewTransform : IsPerspective() ? ViewTransformPerspective : ViewTransformOrthographic; }
 
 	/** Sets the location of the viewport's camera */
 	void SetViewLocation(const FVector& NewLocation)
@@ -173,6 +182,17 @@ public:
 	/** FViewElementDrawer interface */
 	virtual void Draw(FViewport* Viewport, FCanvas* Canvas) override;
 
+	/**
+	 * Renders the views of several viewports sharing one preview scene as a single view family,
+	 * so visibility, shadow depths and GPU scene uploads are done once for all of them.
+	 * Family wide settings (show flags, view mode, time, screen percentage) are taken from the first viewport.
+	 *
+	 * @param Canvas		Canvas of the render target all views are drawn into
+	 * @param Clients		Viewports to draw, each one is drawn with its own viewport size
+	 * @param ViewOffsets	Offset of each viewport's view rect inside the render target
+	 */
+	static void DrawViewFamily(FCanvas* Canvas, TArrayView<FCustomViewportClient* const> Clients, TArrayView<const FIntPoint> ViewOffsets);
+
 	/** FViewportClient interface */
 	virtual void RedrawRequested(FViewport* InViewport) override { bNeedsRedraw = true; }
 	virtual void RequestInvalidateHitProxy(FViewport* InViewport) override {}
@@ -184,6 +204,18 @@ public:
 	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
 	virtual FString GetReferencerName() const override { return TEXT("FCustomViewportClient"); }
 
+	/** @return Construction values of a view family drawing this viewport into RenderTarget */
+	FSceneViewFamily::ConstructionValues MakeViewFamilyConstructionValues(const FRenderTarget* RenderTarget) const;
+
+	/** Configures family wide settings (show flags, view mode, extensions, exposure) for drawing this viewport */
+	virtual void SetupViewFamily(FSceneViewFamily& ViewFamily, FViewport* InViewport, bool bStereoRendering);
+
+	/** Calculates and sets up the view of this viewport and adds it to the family */
+	FSceneView* AddView(FSceneViewFamily& ViewFamily, FViewport* InViewport, const int32 StereoViewIndex = INDEX_NONE);
+
+	/** Sets the screen percentage driver once all views are added */
+	void FinishViewFamily(FSceneViewFamily& ViewFamily, bool bStereoRendering);
+
 	/**
 	 * Called to do any additional set up of the view for rendering
 	 *
@@ -217,6 +249,14 @@ public:
 	 */
 	virtual void OverridePostProcessSettings(FSceneView& View) {};
 
+	/**
+	 * Sets weighted post process layers applied over the post process volumes of the preview world.
+	 * The set is shared by all viewports using it, but each view blends the layers again every frame.
+	 */
+	void SetPostProcessLayers(const TSharedPtr<const FCustomViewportPostProcessLayers>& InPostProcessLayers);
+
+	const TSharedPtr<const FCustomViewportPostProcessLayers>& GetPostProcessLayers() const { return PostProcessLayers; }
+
 	/**
 	 * Ticks this viewport client
 	 */
@@ -245,6 +285,44 @@ public:
 	/** Should this viewport use app time instead of world time. */
 	virtual bool UseAppTime() const { return IsRealtime(); }
 
+	/**
+	 * Sets how long (in seconds) the viewport may stay undrawn and hidden before its scene view states are released.
+	 * Zero disables the release, negative value falls back to ViewportWidget.ViewStateReleaseDelay.
+	 */
+	void SetViewStateReleaseDelay(float InViewStateReleaseDelay) { ViewStateReleaseDelay = InViewStateReleaseDelay; }
+
+	/** @return The effective view state release delay for this viewport */
+	float GetViewStateReleaseDelay() const;
+
+	/**
+	 * Releases the scene view states if the viewport was hidden for longer than the release delay.
+	 *
+	 * @return		The number of bytes freed.
+	 */
+	SIZE_T ReleaseViewStatesIfHidden(double CurrentTime);
+
+	/**
+	 * Releases the scene view states (temporal history, eye adaptation, occlusion). They are allocated again on next draw.
+	 *
+	 * @return		The number of bytes freed.
+	 */
+	SIZE_T ReleaseViewStates();
+
+	/** @return True if view states are currently released */
+	bool HasReleasedViewStates() const { return ViewState.GetReference() == nullptr; }
+
+	/** @return The number of bytes held by the scene view states of this viewport */
+	SIZE_T GetViewStateSizeBytes() const;
+
+	/** @return The number of bytes freed by view state releases of this viewport so far */
+	SIZE_T GetViewStateBytesReleased() const { return ViewStateBytesReleased; }
+
+	/** @return The number of bytes freed by view state releases of all viewports so far */
+	static SIZE_T GetTotalViewStateBytesReleased();
+
+	/** @return All currently alive viewport clients */
+	static const TArray<FCustomViewportClient*>& GetLiveClients();
+
 public:
 	/** True if the window is maximized or floating */
 	bool IsVisible() const;
@@ -304,7 +382,7 @@ public:
 	/**
 	 * Returns the effective viewport type (taking into account any actor locking or camera possession)
 	 */
-	virtual ECustomViewportType GetViewportType() const { return ViewportType; }
+	virtual ECustomViewportType GetViewportType() const { return ActivePaneIndex > 0 ? Panes[ActivePaneIndex - 1].ViewportType : ViewportType; }
 
 	/**
 	 * Set the viewport type of the client
@@ -337,11 +415,58 @@ public:
 	/** Get the editor viewport widget */
 	TSharedPtr<SViewportWidget> GetViewportWidget() const { return ViewportWidget.Pin(); }
 
+	/** Hands the client over to another widget, e.g. when a UMG widget rebuilds its Slate widget */
+	void SetViewportWidget(const TWeakPtr<SViewportWidget>& InViewportWidget) { ViewportWidget = InViewportWidget; }
+
 	/**
 	 * Computes a matrix to use for viewport location and rotation
 	 */
 	virtual FMatrix CalcViewRotationMatrix(const FRotator& InViewRotation) const { return FInverseRotationMatrix(InViewRotation); }
 
+	/** @return The fixed view rotation matrix of an orthographic viewport type */
+	static const FMatrix& GetOrthoViewRotationMatrix(ECustomViewportType InViewportType);
+
+	/**
+	 * Forces the cached draw setup (view matrices, view extensions and resolved post process settings) to be rebuilt on next draw.
+	 * Call it when something the cache can't detect changes, e.g. view extensions were registered. Changes of the world's
+	 * post process volumes and of r.DefaultFeature.* CVars are picked up without it.
+	 */
+	void InvalidateCachedViewSetup();
+
+	/** Maximum number of panes of a split layout */
+	static constexpr int32 MaxPanes = 4;
+
+	/**
+	 * Splits the viewport into 1, 2 (side by side) or 4 (two by two) panes, any other count is rounded up.
+	 * All panes are views of one view family, pane 0 is the viewport's own view and the others have their own type, transform and view state.
+	 */
+	void SetNumPanes(int32 InNumPanes);
+
+	int32 GetNumPanes() const { return Panes.Num() + 1; }
+
+	/** Sets the viewport type and camera of a pane, pane 0 sets the viewport's own view */
+	void SetPaneView(int32 PaneIndex, ECustomViewportType InViewportType, const FVector& InViewLocation, const FRotator& InViewRotation);
+
+	/** @return Rect of a pane inside a viewport of the given size */
+	static FIntRect GetPaneRect(int32 NumPanes, int32 PaneIndex, const FIntPoint& InViewportSize);
+
+	/** Adds the views of all panes to the family, Offset is the position of the viewport inside the family render target */
+	void AddPaneViews(FSceneViewFamily& ViewFamily, FViewport* InViewport, const FIntPoint& Offset);
+
+	/** Shows the performance overlay in this viewport, ViewportWidget.ShowStatsOverlay shows it in all of them */
+	void SetShowStatsOverlay(bool bShow) { bShowStatsOverlay = bShow; }
+
+	bool ShouldDrawStatsOverlay() const;
+
+	/** Draws tick and draw setup times, entry counts, resolution fraction, capture and skipped frame info at Offset */
+	void DrawStatsOverlay(FCanvas* Canvas, const FIntPoint& Offset) const;
+
+	/** @return Game thread milliseconds spent setting up the views of the last draw */
+	double GetLastDrawSetupMs() const { return LastDrawSetupSeconds * 1000.0; }
+
+	/** @return Resolution fraction the last draw was rendered at */
+	float GetLastResolutionFraction() const { return LastResolutionFraction; }
+
 public:
 
 	void SetGameView(bool bGameViewEnable);
@@ -593,6 +718,96 @@ private:
 	/** Delegate handler for when a window DPI changes and we might need to adjust the scenes resolution */
 	void HandleWindowDPIScaleChanged(TSharedRef<SWindow> InWindow);
 
+	/** Allocates the view state of the pane being drawn if it was released */
+	void AllocateViewState();
+
+	/** Destroys all view states without counting them as released, e.g. when they are recreated for another scene */
+	void DestroyViewStates();
+
+	/** Removes temporary debug lines once the world was rendered */
+	static void FlushWorldLineBatchers(UWorld* World);
+
+	/** @return Active view extensions, gathered again only when dirty or every ViewportWidget.ViewExtensionRefreshFrames frames */
+	const TArray<FSceneViewExtensionRef>& GetActiveViewExtensions(FViewport* InViewport);
+
+	/** Everything the view and projection matrices of a non stereo view depend on */
+	struct FViewSetupKey
+	{
+		FRotator ViewRotation = FRotator::ZeroRotator;
+		FIntPoint ViewportSize = FIntPoint::ZeroValue;
+		float FOV = 0.f;
+		float NearPlane = 0.f;
+		ECustomViewportType ViewportType = (ECustomViewportType)0;
+
+		bool operator==(const FViewSetupKey& Other) const
+		{
+			return ViewRotation.Equals(Other.ViewRotation, 0.f) && ViewportSize == Other.ViewportSize && FOV == Other.FOV && NearPlane == Other.NearPlane && ViewportType == Other.ViewportType;
+		}
+	};
+
+	/** View and projection matrices of the last non stereo view */
+	struct FCachedViewSetup
+	{
+		FViewSetupKey Key;
+		FMatrix ViewRotationMatrix = FMatrix::Identity;
+		FMatrix ProjectionMatrix = FMatrix::Identity;
+		bool bValid = false;
+	};
+
+	FCachedViewSetup CachedViewSetup;
+
+	/** Post process settings with the volumes at Location blended in, reused while the view and the world's volumes don't change */
+	struct FCachedPostProcess
+	{
+		FFinalPostProcessSettings Settings;
+		FVector Location = FVector::ZeroVector;
+		/** Signature of the world's post process volumes and default feature CVars the settings were blended with */
+		uint32 VolumeSignature = 0;
+		bool bPostProcessing = false;
+		bool bValid = false;
+	};
+
+	FCachedPostProcess CachedPostProcess;
+
+	/** State of a pane after the first one in a split layout */
+	struct FCustomViewportPane
+	{
+		ECustomViewportType ViewportType = (ECustomViewportType)0;
+		FCustomViewportCameraTransform ViewTransform;
+		FSceneViewStateReference ViewState;
+		FCachedViewSetup CachedViewSetup;
+		FCachedPostProcess CachedPostProcess;
+	};
+
+	/** Panes after the first one, the first pane uses the viewport's own state */
+	TArray<FCustomViewportPane> Panes;
+
+	/** Pane whose view is being calculated, 0 outside of AddPaneViews */
+	int32 ActivePaneIndex = 0;
+
+	FSceneViewStateReference& GetActiveViewState() { return ActivePaneIndex > 0 ? Panes[ActivePaneIndex - 1].ViewState : ViewState; }
+
+	FCachedViewSetup& GetActiveCachedViewSetup() { return ActivePaneIndex > 0 ? Panes[ActivePaneIndex - 1].CachedViewSetup : CachedViewSetup; }
+
+	FCachedPostProcess& GetActiveCachedPostProcess() { return ActivePaneIndex > 0 ? Panes[ActivePaneIndex - 1].CachedPostProcess : CachedPostProcess; }
+
+	/** Drops the resolved post process settings of all panes */
+	void InvalidateCachedPostProcess();
+
+	/** Next entry of the ortho view options RotateViewportType switches to */
+	int32 ViewOptionIndex = 0;
+
+	/** View extensions gathered on the frame ViewExtensionsGatherFrame */
+	TArray<FSceneViewExtensionRef> CachedViewExtensions;
+	uint64 ViewExtensionsGatherFrame = 0;
+	bool bViewExtensionsDirty = true;
+
+	/** View modifiers, kept alive between draws to avoid constructing large post process structs every frame */
+	TUniquePtr<FCustomViewportViewModifierParams> ViewModifierParams;
+
+	/** Post process layers set through SetPostProcessLayers, their objects are reported by AddReferencedObjects */
+	TSharedPtr<const FCustomViewportPostProcessLayers> PostProcessLayers;
+
 public:
 	/** Delegate used to get whether or not this client is in an immersive viewport */
 	FCustomViewportStateGetter ImmersiveDelegate;
@@ -669,6 +884,27 @@ protected:
 	/** Custom override function that will be called every ::Draw() until override is disabled */
 	TUniqueFunction<void(FEngineShowFlags&)> OverrideShowFlagsFunc;
 
+	/** Time of the last ::Draw() call */
+	double LastDrawTime;
+
+	/** Offset of the view rect in the render target, non zero when drawn next to other viewports in one family */
+	FIntPoint ViewRectOffset = FIntPoint::ZeroValue;
+
+	/** Size of the view rect when the viewport is split into panes, zero uses the whole viewport */
+	FIntPoint ViewRectSize = FIntPoint::ZeroValue;
+
+	double LastDrawSetupSeconds = 0.0;
+
+	float LastResolutionFraction = 1.f;
+
+	bool bShowStatsOverlay = false;
+
+	/** Seconds the viewport may stay hidden before its view states are released, see SetViewStateReleaseDelay */
+	float ViewStateReleaseDelay;
+
+	/** Bytes freed by view state releases so far */
+	SIZE_T ViewStateBytesReleased;
+
 public:
 	/* Default view mode for perspective viewports */
 	static const EViewModeIndex DefaultPerspectiveViewMode;
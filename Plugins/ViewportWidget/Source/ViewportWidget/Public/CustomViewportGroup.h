@@ -0,0 +1,74 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "UObject/GCObject.h"
+
+class FCustomPreviewScene;
+class SViewportWidget;
+class UTextureRenderTarget2D;
+
+//------------------------------------------------------
+// FCustomViewportGroup
+//------------------------------------------------------
+
+/**
+ * Several viewport widgets looking at one shared preview scene, e.g. front, back and close-up views of the same item.
+ * The scene world is ticked once per frame and the views of all visible members are rendered as one view family
+ * into a shared render target, each member displays its own region of it. Regions are packed in rows within the
+ * maximum texture size, members that don't fit keep their last frame.
+ */
+class VIEWPORTWIDGET_API FCustomViewportGroup : public FGCObject
+{
+public:
+	/** Creates a group around an existing preview scene, e.g. the one of the first widget joining the group */
+	FCustomViewportGroup(const TSharedRef<FCustomPreviewScene>& InPreviewScene);
+	virtual ~FCustomViewportGroup();
+
+	/** Non-copyable */
+	FCustomViewportGroup(const FCustomViewportGroup&) = delete;
+	FCustomViewportGroup& operator=(const FCustomViewportGroup&) = delete;
+
+	const TSharedRef<FCustomPreviewScene>& GetPreviewScene() const { return PreviewScene; }
+
+	void AddWidget(SViewportWidget* Widget);
+	void RemoveWidget(SViewportWidget* Widget);
+
+	int32 GetNumWidgets() const { return Widgets.Num(); }
+
+	/** Ticks the shared world, only the first call in a frame does the work */
+	void Tick(float DeltaTime);
+
+	/** Draws all visible members in one view family, only the first call in a frame does the work */
+	void Draw();
+
+	/** @return Number of views in the last drawn view family */
+	int32 GetNumViewsDrawn() const { return NumViewsDrawn; }
+
+	/** @return Bytes of the shared render target and of replaced ones still shown by members */
+	SIZE_T GetRenderTargetBytes() const;
+
+	/** FGCObject interface */
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FCustomViewportGroup"); }
+
+private:
+	TSharedRef<FCustomPreviewScene> PreviewScene;
+
+	TArray<SViewportWidget*> Widgets;
+
+	/** Render target all member views are drawn into, packed in rows */
+	UTextureRenderTarget2D* RenderTarget;
+
+	/** Replaced render targets, kept until no member's brush shows them anymore */
+	TArray<UTextureRenderTarget2D*> RetiredRenderTargets;
+
+	/** Releases retired render targets no member shows */
+	void ReleaseRetiredRenderTargets();
+
+	uint64 LastTickFrame;
+
+	uint64 LastDrawFrame;
+
+	int32 NumViewsDrawn;
+};
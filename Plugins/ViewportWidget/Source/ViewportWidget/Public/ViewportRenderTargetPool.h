@@ -0,0 +1,94 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "UObject/GCObject.h"
+#include "PixelFormat.h"
+
+class UTextureRenderTarget2D;
+
+//------------------------------------------------------
+// FViewportRenderTargetPool
+//------------------------------------------------------
+
+/**
+ * Render targets shared by viewport widgets that don't draw every frame.
+ * Widgets borrow a target only while drawing and keep a compact cached copy of the final color themselves.
+ */
+class VIEWPORTWIDGET_API FViewportRenderTargetPool : public FGCObject
+{
+public:
+	static FViewportRenderTargetPool& Get();
+
+	/**
+	 * Borrows a render target of the given size and format, creating one if the pool has none.
+	 * Must be returned with Release as soon as drawing is done.
+	 */
+	UTextureRenderTarget2D* Acquire(const FIntPoint& Size, EPixelFormat Format);
+
+	/** Returns a borrowed render target to the pool */
+	void Release(UTextureRenderTarget2D* RenderTarget);
+
+	/** Frees pooled render targets that were not borrowed for longer than MaxIdleSeconds */
+	void Trim(double MaxIdleSeconds);
+
+	/** Creates a cached copy target owned by the caller, its memory is accounted by the pool counters of its format */
+	UTextureRenderTarget2D* CreateCachedCopy(const FIntPoint& Size, EPixelFormat Format);
+
+	/** Notifies the pool that a cached copy created with CreateCachedCopy is no longer used */
+	void ReleaseCachedCopy(UTextureRenderTarget2D* RenderTarget);
+
+	/** @return Number of render targets waiting in the pool */
+	int32 GetNumPooled() const;
+
+	/** @return Number of render targets currently borrowed */
+	int32 GetNumBorrowed() const { return BorrowedRenderTargets.Num(); }
+
+	/** @return Bytes held by pooled and borrowed render targets */
+	SIZE_T GetPoolBytes() const { return PoolBytes; }
+
+	/** @return Bytes held by cached copies of all widgets */
+	SIZE_T GetCachedCopyBytes() const { return CachedCopyBytes; }
+
+	/** @return Bytes held by cached copies of the given format, e.g. PF_FloatRGBA copies of HDR widgets */
+	SIZE_T GetCachedCopyBytes(EPixelFormat Format) const;
+
+	/** @return Cached copy bytes by format, formats without copies are left out */
+	const TMap<EPixelFormat, SIZE_T>& GetCachedCopyBytesByFormat() const { return CachedCopyBytesByFormat; }
+
+	/** @return Estimated GPU memory of a render target */
+	static SIZE_T CalcRenderTargetBytes(const UTextureRenderTarget2D* RenderTarget);
+
+	/** FGCObject interface */
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FViewportRenderTargetPool"); }
+
+private:
+	struct FPoolKey
+	{
+		FIntPoint Size;
+		EPixelFormat Format;
+
+		bool operator==(const FPoolKey& Other) const { return Size == Other.Size && Format == Other.Format; }
+
+		friend uint32 GetTypeHash(const FPoolKey& Key) { return HashCombine(GetTypeHash(Key.Size), GetTypeHash((uint8)Key.Format)); }
+	};
+
+	struct FPooledRenderTarget
+	{
+		UTextureRenderTarget2D* RenderTarget;
+		double LastUseTime;
+	};
+
+	static UTextureRenderTarget2D* CreateRenderTarget(const FIntPoint& Size, EPixelFormat Format);
+
+	TMap<FPoolKey, TArray<FPooledRenderTarget>> FreeRenderTargets;
+
+	TArray<UTextureRenderTarget2D*> BorrowedRenderTargets;
+
+	SIZE_T PoolBytes = 0;
+
+	SIZE_T CachedCopyBytes = 0;
+
+	TMap<EPixelFormat, SIZE_T> CachedCopyBytesByFormat;
+};
@@ -20,6 +20,47 @@ enum class ECustomViewportType :uint8
 	CVT_OrthoNegativeYZ = 7	UMETA(DisplayName = "Ortho Right"),
 };
 
+UENUM(BlueprintType)
+enum class EViewportWidgetRenderMode :uint8
+{
+	Realtime = 0	UMETA(DisplayName = "Realtime", ToolTip = "Draws every frame"),
+	OnDemand = 1	UMETA(DisplayName = "On Demand", ToolTip = "Draws only when content, camera or size changes or a redraw is requested"),
+	Scheduled = 2	UMETA(DisplayName = "Scheduled", ToolTip = "Draws on demand and at a fixed interval"),
+};
+
+UENUM(BlueprintType)
+enum class EViewportWidgetLayout :uint8
+{
+	OnePane = 0		UMETA(DisplayName = "One Pane"),
+	TwoPanes = 1	UMETA(DisplayName = "Two Panes", ToolTip = "Two views side by side"),
+	FourPanes = 2	UMETA(DisplayName = "Four Panes", ToolTip = "Four views two by two"),
+};
+
+/** @return Number of views shown in the layout */
+inline int32 GetViewportWidgetLayoutNumPanes(EViewportWidgetLayout Layout)
+{
+	return Layout == EViewportWidgetLayout::FourPanes ? 4 : Layout == EViewportWidgetLayout::TwoPanes ? 2 : 1;
+}
+
+//------------------------------------------------------
+// FViewportWidgetPane
+//------------------------------------------------------
+
+USTRUCT(BlueprintType)
+struct VIEWPORTWIDGET_API FViewportWidgetPane
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	FViewportWidgetPane() :ViewportType(ECustomViewportType::CVT_Perspective), ViewTransform(FTransform::Identity) {}
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	ECustomViewportType ViewportType;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FTransform ViewTransform;
+};
+
 //------------------------------------------------------
 // FViewportWidgetEntry
 //------------------------------------------------------
@@ -32,14 +73,67 @@ struct VIEWPORTWIDGET_API FViewportWidgetEntry
 public:
 	static const TArray<FViewportWidgetEntry>& GetEmptyCollection() { static TArray<FViewportWidgetEntry> emptyCollection; return emptyCollection; }
 
-	FViewportWidgetEntry() :ActorClassPtr(nullptr), SpawnTransform(FTransform::Identity), ActorObjectPtr(nullptr) {}
+	FViewportWidgetEntry() :ActorClassPtr(nullptr), SpawnTransform(FTransform::Identity), LeaderEntryIndex(INDEX_NONE), ActorObjectPtr(nullptr) {}
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TSoftClassPtr<AActor> ActorClassPtr;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FTransform SpawnTransform;
+
+	/**
+	 * Entry whose skeletal mesh pose this entry's skeletal mesh copies instead of evaluating its own animation,
+	 * e.g. a squad playing the same idle. INDEX_NONE animates on its own, or joins an automatic group if the widget shares poses.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	int32 LeaderEntryIndex;
 	
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	TWeakObjectPtr<AActor> ActorObjectPtr;
+};
+
+//------------------------------------------------------
+// FViewportWidgetEntryCost
+//------------------------------------------------------
+
+/** Cost of one spawned entry actor, see SViewportWidget::GetEntryCosts */
+USTRUCT(BlueprintType)
+struct VIEWPORTWIDGET_API FViewportWidgetEntryCost
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 EntryIndex = INDEX_NONE;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	TSoftClassPtr<AActor> ActorClassPtr;
+
+	/** Number of entries this cost sums up, 1 for a single entry */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumEntries = 0;
+
+	/** Average game thread milliseconds the actor and its components spent ticking per frame, measured while entry costs are tracked */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float TickMs = 0.f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumComponents = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumPrimitives = 0;
+
+	/** Bones of all skeletal meshes */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumBones = 0;
+
+	/** Estimated mesh draw calls per view, material sections of visible primitives doubled for shadow casters */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 EstimatedDrawCalls = 0;
+
+	/** Triangles of the most detailed LOD of visible meshes */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumTriangles = 0;
+
+	void Accumulate(const FViewportWidgetEntryCost& Other);
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "Blueprint/UserWidget.h"
+#include "Blueprint/IUserObjectListEntry.h"
+#include "ViewportWidgetEntry.h"
+#include "ViewportWidgetListEntry.generated.h"
+
+class UViewportWidget;
+
+//------------------------------------------------------
+// UViewportWidgetListItem
+//------------------------------------------------------
+
+/** List view item describing a preview, shown by UViewportWidgetListEntry */
+UCLASS(BlueprintType)
+class VIEWPORTWIDGET_API UViewportWidgetListItem : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FViewportWidgetEntry> Entries;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FTransform ViewTransform;
+};
+
+//------------------------------------------------------
+// UViewportWidgetListEntry
+//------------------------------------------------------
+
+/**
+ * List or tile view entry with a viewport widget bound as ViewportWidget.
+ * When the view recycles the entry for another item, the widget is retargeted instead of rebuilt,
+ * so the preview world and the actors of matching entries are reused.
+ */
+UCLASS(Abstract)
+class VIEWPORTWIDGET_API UViewportWidgetListEntry : public UUserWidget, public IUserObjectListEntry
+{
+	GENERATED_BODY()
+
+protected:
+	//~ IUserObjectListEntry interface
+	virtual void NativeOnListItemObjectSet(UObject* ListItemObject) override;
+	//~ End of IUserObjectListEntry interface
+
+	/** Provides the preview of a list item, by default the entries and view of a UViewportWidgetListItem */
+	UFUNCTION(BlueprintNativeEvent)
+	bool GetListItemPreview(UObject* ListItemObject, TArray<FViewportWidgetEntry>& OutEntries, FTransform& OutViewTransform) const;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidget))
+	TObjectPtr<UViewportWidget> ViewportWidget;
+};
@@ -3,6 +3,106 @@
 #pragma once
 
 #include "Modules/ModuleManager.h"
+#include "Containers/Ticker.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/Histogram.h"
+
+class SViewportWidget;
+
+VIEWPORTWIDGET_API DECLARE_LOG_CATEGORY_EXTERN(LogViewportWidget, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("ViewportWidget"), STATGROUP_ViewportWidget, STATCAT_Advanced);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(VIEWPORTWIDGET_API, ViewportWidget);
+
+//------------------------------------------------------
+// FViewportWidgetStats
+//------------------------------------------------------
+
+/** Live object counts shown by stat ViewportWidget and recorded in CSV captures */
+struct VIEWPORTWIDGET_API FViewportWidgetStats
+{
+	static int32 NumLiveWidgets;
+	static int32 NumSpawnedActors;
+	static int32 NumPreviewWorlds;
+
+	/** Entry actors whose PSOs were precached when they were spawned, and ones still compiling them */
+	static int32 NumPSOPrecacheHits;
+	static int32 NumPSOPrecacheMisses;
+
+	static void AddLiveWidgets(int32 Delta);
+	static void AddSpawnedActors(int32 Delta);
+	static void AddPreviewWorlds(int32 Delta);
+	static void AddPSOPrecacheResult(bool bHit);
+};
+
+//------------------------------------------------------
+// FViewportWidgetTimings
+//------------------------------------------------------
+
+enum class EViewportWidgetTiming : uint8
+{
+	/** Synchronous load of an entry class */
+	ClassLoad,
+	/** Spawning and setting up an entry actor */
+	Spawn,
+	/** Creating the preview world of a widget */
+	WorldCreation,
+	/** From constructing a widget or changing its entries until it is drawn, spans several frames so it isn't a hitch */
+	FirstDraw,
+	Num
+};
+
+/**
+ * Millisecond histograms of operations that may hitch when preview screens open, dumped by ViewportWidget.DumpTimings.
+ * Measurements above ViewportWidget.HitchThresholdMs, or ViewportWidget.FirstDrawThresholdMs for first draws, log a one line summary,
+ * this doesn't depend on stats so works in test builds.
+ */
+struct VIEWPORTWIDGET_API FViewportWidgetTimings
+{
+	static void Record(EViewportWidgetTiming Timing, double Ms, const SViewportWidget* Widget, int32 EntryIndex = INDEX_NONE, const UClass* Class = nullptr);
+
+	static const FHistogram& GetHistogram(EViewportWidgetTiming Timing);
+
+	static const TCHAR* GetTimingName(EViewportWidgetTiming Timing);
+
+	static int32 GetNumHitches() { return NumHitches; }
+
+	static void Reset();
+
+	static void Dump(FOutputDevice& Ar);
+
+private:
+	static FHistogram& GetMutableHistogram(EViewportWidgetTiming Timing);
+
+	static int32 NumHitches;
+};
+
+//------------------------------------------------------
+// FViewportWidgetMemoryUsage
+//------------------------------------------------------
+
+/** Memory held by viewport widgets, reported by ViewportWidget.MemReport and memreport */
+struct VIEWPORTWIDGET_API FViewportWidgetMemoryUsage
+{
+	/** Preview worlds, levels, actors and components */
+	SIZE_T UObjectBytes = 0;
+
+	/** Resources owned exclusively by preview scene objects, assets shared with the rest of the game are excluded */
+	SIZE_T RenderResourceBytes = 0;
+
+	SIZE_T ViewStateBytes = 0;
+
+	/** Viewport targets, cached copies and group render targets */
+	SIZE_T RenderTargetBytes = 0;
+
+	int32 NumObjects = 0;
+
+	SIZE_T GetTotalBytes() const { return UObjectBytes + RenderResourceBytes + ViewStateBytes + RenderTargetBytes; }
+
+	FViewportWidgetMemoryUsage& operator+=(const FViewportWidgetMemoryUsage& Other);
+};
 
 //------------------------------------------------------
 // FViewportWidgetModule
@@ -13,4 +113,19 @@ class FViewportWidgetModule : public IModuleInterface
 public:
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+protected:
+	/** Periodic housekeeping for all live viewport clients (view state release etc.) */
+	bool Tick(float DeltaTime);
+
+	/** Records the live object counts once per frame in CSV captures */
+	void OnEndFrame();
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	FDelegateHandle EndFrameHandle;
+
+	double LastMemoryBudgetCheckTime = 0.0;
+
+	bool bMemoryBudgetExceeded = false;
 };
\ No newline at end of file
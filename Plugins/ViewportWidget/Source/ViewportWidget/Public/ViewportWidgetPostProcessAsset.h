@@ -0,0 +1,85 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "Engine/Scene.h"
+#include "ViewportWidgetPostProcessAsset.generated.h"
+
+class FSceneView;
+
+//------------------------------------------------------
+// FViewportWidgetPostProcessLayer
+//------------------------------------------------------
+
+USTRUCT(BlueprintType)
+struct VIEWPORTWIDGET_API FViewportWidgetPostProcessLayer
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	FViewportWidgetPostProcessLayer() :Weight(1.f) {}
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ShowOnlyInnerProperties))
+	FPostProcessSettings Settings;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float Weight;
+};
+
+//------------------------------------------------------
+// FCustomViewportPostProcessLayers
+//------------------------------------------------------
+
+/**
+ * Immutable set of weighted post process layers shared by every viewport using it.
+ * Holders outside UPROPERTYs report the referenced blendables and textures through AddReferencedObjects.
+ *
+ * The blend itself is not cached, every view blends the layers again each frame as they go over volumes and camera settings
+ * that may change at any time. Layers can't be collapsed into one composite either, as LUTs, cubemaps and blendables
+ * accumulate per layer. Only the layers that can change anything are picked once when the set is created.
+ */
+class VIEWPORTWIDGET_API FCustomViewportPostProcessLayers
+{
+public:
+	static TSharedRef<const FCustomViewportPostProcessLayers> Create(const TArray<FViewportWidgetPostProcessLayer>& InLayers);
+
+	const TArray<FViewportWidgetPostProcessLayer>& GetLayers() const { return Layers; }
+
+	/** Blends the layers in order over the view's final post process settings, each with its own weight, called for every view and frame */
+	void ApplyTo(FSceneView& View) const;
+
+	void AddReferencedObjects(FReferenceCollector& Collector) const;
+
+private:
+	FCustomViewportPostProcessLayers(const TArray<FViewportWidgetPostProcessLayer>& InLayers);
+
+	TArray<FViewportWidgetPostProcessLayer> Layers;
+
+	/** Layers with a weight and at least one overridden property, the others would leave the view unchanged */
+	TArray<int32> ActiveLayerIndices;
+};
+
+//------------------------------------------------------
+// UViewportWidgetPostProcessAsset
+//------------------------------------------------------
+
+UCLASS(BlueprintType)
+class VIEWPORTWIDGET_API UViewportWidgetPostProcessAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** @return Layer set shared by all widgets using this asset */
+	TSharedRef<const FCustomViewportPostProcessLayers> GetLayerSet() const;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TArray<FViewportWidgetPostProcessLayer> Layers;
+
+private:
+	mutable TSharedPtr<const FCustomViewportPostProcessLayers> LayerSet;
+};
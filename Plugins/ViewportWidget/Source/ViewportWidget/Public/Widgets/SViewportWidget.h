@@ -4,9 +4,36 @@
 
 #include "Widgets/SViewport.h"
 #include "ViewportWidgetEntry.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Engine/TextureRenderTarget2D.h"
 
 class FCustomViewportClient;
 class FCustomPreviewScene;
+class FCustomViewportPostProcessLayers;
+class FCustomViewportGroup;
+class SImage;
+class FOutputDevice;
+struct FViewportWidgetMemoryUsage;
+struct FViewportWidgetPendingSwap;
+struct FViewportWidgetPrefetch;
+struct FViewportWidgetEntryTickTimer;
+
+//------------------------------------------------------
+// FViewportWidgetPreservedState
+//------------------------------------------------------
+
+/** Preview scene, viewport client and spawned entries of a released widget, handed to its replacement so nothing is created or spawned again */
+struct VIEWPORTWIDGET_API FViewportWidgetPreservedState
+{
+	/** Destroys entry actors nobody took over */
+	~FViewportWidgetPreservedState();
+
+	TSharedPtr<FCustomPreviewScene> PreviewScene;
+
+	TSharedPtr<FCustomViewportClient> Client;
+
+	TArray<FViewportWidgetEntry> Entries;
+};
 
 //------------------------------------------------------
 // SViewportWidget
@@ -15,10 +42,29 @@ class FCustomPreviewScene;
 class VIEWPORTWIDGET_API SViewportWidget : public SCompoundWidget
 {
 public:
-	SLATE_BEGIN_ARGS(SViewportWidget) :_ViewportSize(SViewport::FArguments::GetDefaultViewportSize()), _ViewTransform(FTransform::Identity), _Entries(FViewportWidgetEntry::GetEmptyCollection()) {}
+	SLATE_BEGIN_ARGS(SViewportWidget) :_ViewportSize(SViewport::FArguments::GetDefaultViewportSize()), _ViewTransform(FTransform::Identity), _Entries(FViewportWidgetEntry::GetEmptyCollection()), _ViewStateReleaseDelay(-1.f), _RenderMode(EViewportWidgetRenderMode::Realtime), _ScheduledRedrawInterval(1.f), _UsePooledRenderTarget(true), _Layout(EViewportWidgetLayout::OnePane), _ShowStatsOverlay(false), _SharePoses(false), _StagedInitialization(false), _PlaceholderBrush(nullptr) {}
 	SLATE_ATTRIBUTE(FVector2D, ViewportSize);
 	SLATE_ATTRIBUTE(FTransform, ViewTransform);
 	SLATE_ATTRIBUTE(TArray<FViewportWidgetEntry>, Entries);
+	SLATE_ARGUMENT(float, ViewStateReleaseDelay);
+	SLATE_ARGUMENT(EViewportWidgetRenderMode, RenderMode);
+	SLATE_ARGUMENT(float, ScheduledRedrawInterval);
+	/** Non realtime widgets borrow a pooled render target while drawing and only keep a cached copy of the final color */
+	SLATE_ARGUMENT(bool, UsePooledRenderTarget);
+	SLATE_ARGUMENT(TSharedPtr<const FCustomViewportPostProcessLayers>, PostProcessLayers);
+	/** Group whose preview scene the widget shares, null to create a scene of its own */
+	SLATE_ARGUMENT(TSharedPtr<FCustomViewportGroup>, ViewportGroup);
+	SLATE_ARGUMENT(EViewportWidgetLayout, Layout);
+	/** Views of the panes after the first one, the first pane shows ViewTransform */
+	SLATE_ARGUMENT(TArray<FViewportWidgetPane>, Panes);
+	SLATE_ARGUMENT(bool, ShowStatsOverlay);
+	/** Entries without a LeaderEntryIndex follow the pose of the first entry of the same class and anim instance */
+	SLATE_ARGUMENT(bool, SharePoses);
+	/** Spreads creating the widget's own preview world over several frames, the placeholder is shown until it is ready */
+	SLATE_ARGUMENT(bool, StagedInitialization);
+	SLATE_ARGUMENT(const FSlateBrush*, PlaceholderBrush);
+	/** State of a released widget to continue with, its entries are kept if they match Entries */
+	SLATE_ARGUMENT(TSharedPtr<FViewportWidgetPreservedState>, PreservedState);
 	SLATE_END_ARGS()
 
 	SViewportWidget();
@@ -30,13 +76,45 @@ public:
 
 	void SetEntries(TArray<FViewportWidgetEntry>& entries);
 
+	/**
+	 * Shows other entries in the same preview world, e.g. when a list view recycles the widget for another item.
+	 * Actors of entries at the same index and of the same class are moved instead of respawned,
+	 * actors no longer needed go to the scene's actor pool and new ones are taken from it when possible.
+	 */
+	void RetargetEntries(TArray<FViewportWidgetEntry>& entries, const FTransform& viewTransform);
+
+	/**
+	 * Shows other entries without an empty or half spawned frame in between. Entry classes are loaded asynchronously and the new
+	 * actors spawned hidden over several frames within ViewportWidget.SwapSpawnBudgetMs, then both sets are swapped in one frame.
+	 * The old actors go to the actor pool once the first frame showing the new ones was rendered.
+	 */
+	void SwapEntries(TArray<FViewportWidgetEntry>& entries);
+
+	/** @return True while entries of SwapEntries are loaded or spawned, or old actors wait to be released */
+	bool IsSwapPending() const;
+
+	/**
+	 * Warms up entries likely shown next, e.g. neighbours in a carousel or a hovered item. Their classes are loaded asynchronously
+	 * and kept loaded, with preSpawn dormant actors are spawned into the actor pool a few per frame so showing them spawns nothing.
+	 * Up to ViewportWidget.MaxPrefetches entry sets are kept, one is dropped once shown through SetEntries, SwapEntries or RetargetEntries.
+	 */
+	void PrefetchEntries(const TArray<FViewportWidgetEntry>& entries, bool preSpawn = false);
+
+	int32 GetNumPrefetches() const;
+
 	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
 
+	/** Not volatile, a drawn frame invalidates only the widget's own paint so invalidation panels around it keep their cache */
+	virtual bool ComputeVolatility() const override { return false; }
+
 	/** @return True if the viewport is currently visible */
 	virtual bool IsVisible() const;
 
 	TSharedPtr<FCustomViewportClient> GetViewportClient() const { return Client; }
 
+	/** @return Serial number of the widget, unique for the session and shown as #id by reports and hitch logs */
+	uint32 GetWidgetId() const { return WidgetId; }
+
 	/**
 	 * @return The current FSceneViewport shared pointer
 	 */
@@ -44,7 +122,89 @@ public:
 
 	TWeakObjectPtr<AActor> GetSpawnedActor(const int32 entryIndex) const;
 
+	/** @return Number of entry actors currently spawned in the preview scene */
+	int32 GetNumSpawnedActors() const;
+
+	int32 GetNumEntries() const { return Entries.IsSet() ? Entries.Get().Num() : 0; }
+
+	/**
+	 * Measures the cost of every spawned entry. TickMs is the average time the entry spent ticking in the preview world tick
+	 * since tracking started, zero unless tracking is enabled with SetTrackEntryCosts or ViewportWidget.TrackEntryCosts.
+	 */
+	TArray<FViewportWidgetEntryCost> GetEntryCosts() const;
+
+	/** Times entry ticks as part of the world tick until disabled again */
+	void SetTrackEntryCosts(bool trackEntryCosts);
+
+	/** @return Entry costs summed up by ActorClassPtr, most expensive tick first */
+	static TArray<FViewportWidgetEntryCost> AggregateCostsByClass(const TArray<FViewportWidgetEntryCost>& EntryCosts);
+
+	/** Logs entry and class costs */
+	void LogEntryCosts() const;
+
+	/** @return Milliseconds the last tick took, drawing included */
+	double GetLastTickMs() const { return LastTickSeconds * 1000.0; }
+
+	/** @return Number of ticks that didn't draw because nothing changed */
+	int32 GetNumSkippedFrames() const { return NumSkippedFrames; }
+
+	void SetShowStatsOverlay(bool showStatsOverlay);
+
+	/** Groups entries without a LeaderEntryIndex by class and anim instance, only the first of each group evaluates its anim graph */
+	void SetSharePoses(bool sharePoses);
+
+	/**
+	 * @return Memory held by the widget, the preview scene is included only if includeScene is set,
+	 * as widgets of a group share one scene
+	 */
+	FViewportWidgetMemoryUsage GetMemoryUsage(bool includeScene = true) const;
+
+	/** @return Memory held by all live widgets, shared scenes and group render targets counted once, pooled render targets included */
+	static FViewportWidgetMemoryUsage GetTotalMemoryUsage();
+
+	/** Writes per widget and total memory usage, used by ViewportWidget.MemReport and memreport */
+	static void ReportMemoryUsage(FOutputDevice& Ar);
+
+	EViewportWidgetRenderMode GetRenderMode() const { return RenderMode; }
+
+	void SetRenderMode(EViewportWidgetRenderMode renderMode, float scheduledRedrawInterval);
+
+	/** Requests a redraw for on demand and scheduled render modes */
+	void RequestRedraw();
+
+	void SetPostProcessLayers(const TSharedPtr<const FCustomViewportPostProcessLayers>& postProcessLayers);
+
+	/** Splits the viewport into panes rendered in one pass over one world tick */
+	void SetLayout(EViewportWidgetLayout layout);
+
+	/** Sets the views of the panes after the first one */
+	void SetPanes(const TArray<FViewportWidgetPane>& panes);
+
+	/** @return True if the widget draws into a pooled render target instead of its own viewport target */
+	bool UsesPooledRenderTarget() const { return bUsePooledRenderTarget && RenderMode != EViewportWidgetRenderMode::Realtime; }
+
+	/** @return True if the widget displays a cached image instead of its own viewport target */
+	bool UsesCachedImage() const { return ViewportGroup.IsValid() || UsesPooledRenderTarget(); }
+
+	TSharedPtr<FCustomPreviewScene> GetPreviewScene() const { return PreviewScene; }
+
+	TSharedPtr<FCustomViewportGroup> GetViewportGroup() const { return ViewportGroup; }
+
+	/** Joins or leaves a group, entries are spawned again when the preview scene changes */
+	void SetViewportGroup(const TSharedPtr<FCustomViewportGroup>& viewportGroup);
+
+	/**
+	 * Hands the preview scene, viewport client and spawned entries over to be passed to a new widget as PreservedState.
+	 * The widget is left empty and draws nothing afterwards.
+	 */
+	TSharedRef<FViewportWidgetPreservedState> DetachPreservedState();
+
+	/** @return New preview scene with the settings used by standalone widgets */
+	static TSharedRef<FCustomPreviewScene> MakeDefaultPreviewScene(bool stagedInitialization = false);
+
 protected:
+	friend class FCustomViewportGroup;
+
 	virtual TSharedRef<FCustomViewportClient> MakeViewportClient();
 
 	void CleanEntries();
@@ -52,6 +212,75 @@ protected:
 
 	virtual void SetupSpawnedActor(AActor* actor, UWorld* world) {}
 
+	/** Takes the entry's actor from the actor pool or spawns it, loading the class if needed */
+	AActor* SpawnEntryActor(const FViewportWidgetEntry& ViewportWidgetEntry, int32 entryIndex);
+
+	/** Spawns a new actor of the class into the preview world, without the pool, and calls SetupSpawnedActor */
+	AActor* SpawnNewActor(UClass* actorClass, const FTransform& transform);
+
+	/** Puts the actor into the actor pool, or destroys it if the pool is full */
+	void ReleaseEntryActor(AActor* actor);
+
+	bool ShouldDraw(float DeltaTime);
+
+	void Draw();
+
+	void DrawToPooledRenderTarget();
+
+	void ReleaseCachedRenderTarget();
+
+	/** Switches between drawing into the viewport's own render target and displaying the cached image */
+	void UpdateViewportTarget();
+
+	/** Called by the group once the views of all its members are drawn, Region is the part of RenderTarget showing this widget */
+	void OnDrawnInGroup(UTextureRenderTarget2D* RenderTarget, const FIntRect& Region);
+
+	EVisibility GetPlaceholderVisibility() const;
+
+	/** Spawns the entries once the preview world finished its staged initialization */
+	void OnPreviewSceneReady();
+
+	/** Invalidates the widget's own paint after a new frame was drawn, not its layout or any parent */
+	void InvalidateAfterDraw(bool brushChanged);
+
+	/** Sets the leader pose component of every entry's skeletal mesh from LeaderEntryIndex and automatic groups */
+	void ApplyPoseSharing();
+
+	/** Takes over the leader indices of entries otherwise equal to the shown ones, re-applying pose sharing instead of respawning */
+	void UpdateEntryLeaders(const TArray<FViewportWidgetEntry>& entries);
+
+	/** Registers the view with the texture streamer for this frame, called only on frames the preview is drawn */
+	void AddStreamingViewInformation();
+
+	/** @return Width of the viewport in pixels, 0 until it is sized */
+	float GetStreamingScreenSize() const;
+
+	/** Records the first draw latency if a draw is pending since construction or an entry change */
+	void RecordFirstDraw();
+
+	/** Spawns the next entries of a pending swap, swaps them in once all are spawned and releases the old actors once that was rendered */
+	void TickPendingSwap();
+
+	/** Fences the first frame drawn after the swap */
+	void OnSwapDrawn();
+
+	/** Releases the actors of a pending swap that aren't shown */
+	void CancelPendingSwap();
+
+	/** Pre-spawns dormant actors of loaded prefetches into the actor pool, within ViewportWidget.PrefetchSpawnsPerFrame */
+	void TickPrefetches();
+
+	/** Creates and drops entry tick timers so they match the spawned entries while entry costs are tracked */
+	void UpdateEntryTickTimers();
+
+	/** Shows actors hidden by ViewportWidget.DelayShowUntilPSOsPrecached once their PSOs compiled or the timeout passed */
+	void TickPSOPrecachingActors();
+
+	bool IsWaitingForPSOs(const AActor* actor) const;
+
+	/** Forgets the prefetch of these entries as they are shown now */
+	void DropPrefetch(const TArray<FViewportWidgetEntry>& entries);
+
 protected:
 	/** Viewport that renders the scene provided by the viewport client */
 	TSharedPtr<FSceneViewport> SceneViewport;
@@ -67,7 +296,52 @@ protected:
 
 	TSharedPtr<FCustomPreviewScene> PreviewScene;
 
+	TSharedPtr<FCustomViewportGroup> ViewportGroup;
+
 	TAttribute<FTransform> ViewTransform;
 
 	TAttribute<TArray<FViewportWidgetEntry>> Entries;
+
+	EViewportWidgetRenderMode RenderMode;
+
+	float ScheduledRedrawInterval;
+
+	float TimeSinceLastDraw;
+
+	bool bUsePooledRenderTarget;
+
+	/** Size the viewport had when it was drawn the last time */
+	FIntPoint LastDrawnSize;
+
+	double LastTickSeconds;
+
+	int32 NumSkippedFrames;
+
+	/** Time the widget was constructed or its entries changed without being drawn since, zero if drawn */
+	double FirstDrawPendingTime;
+
+	/** False until the entries were spawned into a staged preview world that finished initialization */
+	bool bPreviewSceneReady;
+
+	TUniquePtr<FViewportWidgetPendingSwap> PendingSwap;
+
+	bool bSharePoses;
+
+	TArray<TUniquePtr<FViewportWidgetPrefetch>> Prefetches;
+
+	bool bTrackEntryCosts;
+
+	uint32 WidgetId;
+
+	TArray<TUniquePtr<FViewportWidgetEntryTickTimer>> EntryTickTimers;
+
+	/** Entry actors kept hidden while their PSOs compile, with the time they were spawned */
+	TArray<TPair<TWeakObjectPtr<AActor>, double>> PSOPrecachingActors;
+
+	/** Compact copy of the last drawn frame when drawing into pooled render targets */
+	TStrongObjectPtr<UTextureRenderTarget2D> CachedRenderTarget;
+
+	FSlateBrush CachedBrush;
+
+	TSharedPtr<SImage> CachedImage;
 };
\ No newline at end of file
@@ -0,0 +1,736 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#include "ViewportWidgetBenchmarkCommandlet.h"
+#include "ViewportWidgetModule.h"
+#include "ViewportWidgetPerfTest.h"
+#include "CustomPreviewScene.h"
+#include "Widgets/SViewportWidget.h"
+
+#include "Framework/Application/SlateApplication.h"
+#include "Slate/WidgetRenderer.h"
+#include "Slate/SceneViewport.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "RenderingThread.h"
+#include "RHI.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Misc/AutomationTest.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Interfaces/IPluginManager.h"
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, ViewportWidgetDeveloper)
+
+//------------------------------------------------------
+// FViewportWidgetPerfTest
+//------------------------------------------------------
+
+const TCHAR* FViewportWidgetPerfTest::MannequinClassPath = TEXT("/ViewportWidget/PentangleStudio/ViewportWidget/Blueprints/BP_Mannequin.BP_Mannequin_C");
+const TCHAR* FViewportWidgetPerfTest::DynamicLightClassPath = TEXT("/ViewportWidget/PentangleStudio/ViewportWidget/Blueprints/BP_DynamicLight.BP_DynamicLight_C");
+
+namespace ViewportWidgetPerfTest_NM
+{
+	struct FMetric
+	{
+		const TCHAR* Name;
+		double FViewportWidgetPerfTest::FResults::* Value;
+	};
+
+	static const FMetric Metrics[] =
+	{
+		{ TEXT("WorldCreationMs"), &FViewportWidgetPerfTest::FResults::WorldCreationMs },
+		{ TEXT("SpawnMs"), &FViewportWidgetPerfTest::FResults::SpawnMs },
+		{ TEXT("DiffMs"), &FViewportWidgetPerfTest::FResults::DiffMs },
+		{ TEXT("TickMs"), &FViewportWidgetPerfTest::FResults::TickMs },
+		{ TEXT("TeardownMs"), &FViewportWidgetPerfTest::FResults::TeardownMs },
+	};
+
+	/** Differences below this are measurement noise, whatever the tolerance */
+	const double MinRegressionMs = 0.05;
+}
+
+TSharedRef<FJsonObject> FViewportWidgetPerfTest::FResults::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+
+	for (const ViewportWidgetPerfTest_NM::FMetric& Metric : ViewportWidgetPerfTest_NM::Metrics)
+	{
+		Json->SetNumberField(Metric.Name, this->*Metric.Value);
+	}
+
+	return Json;
+}
+
+bool FViewportWidgetPerfTest::FResults::FromJson(const TSharedPtr<FJsonObject>& Json, FResults& OutResults)
+{
+	if (!Json.IsValid())
+	{
+		return false;
+	}
+
+	for (const ViewportWidgetPerfTest_NM::FMetric& Metric : ViewportWidgetPerfTest_NM::Metrics)
+	{
+		if (!Json->TryGetNumberField(Metric.Name, OutResults.*Metric.Value))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TArray<FViewportWidgetEntry> FViewportWidgetPerfTest::MakeGridEntries(const TSoftClassPtr<AActor>& ActorClass, int32 NumEntries)
+{
+	const int32 GridSize = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt((float)NumEntries)));
+	const float Spacing = 200.f;
+
+	TArray<FViewportWidgetEntry> Entries;
+	Entries.SetNum(NumEntries);
+
+	for (int32 EntryIndex = 0; EntryIndex < NumEntries; ++EntryIndex)
+	{
+		Entries[EntryIndex].ActorClassPtr = ActorClass;
+		Entries[EntryIndex].SpawnTransform.SetLocation(FVector((EntryIndex % GridSize) * Spacing, (EntryIndex / GridSize) * Spacing, 0.f));
+	}
+
+	return Entries;
+}
+
+FViewportWidgetPerfTest::FResults FViewportWidgetPerfTest::Run(const FSettings& Settings)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FViewportWidgetPerfTest::Run);
+
+	FResults Results;
+
+	const int32 NumWidgets = FMath::Max(Settings.NumWidgets, 1);
+	const int32 NumTicks = FMath::Max(Settings.NumTicks, 1);
+
+	// Class loading is not part of any measured phase
+	Settings.ActorClass.LoadSynchronous();
+
+	TArray<FViewportWidgetEntry> Entries = MakeGridEntries(Settings.ActorClass, Settings.NumEntries);
+	TArray<TSharedPtr<SViewportWidget>> Widgets;
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 WidgetIndex = 0; WidgetIndex < NumWidgets; ++WidgetIndex)
+	{
+		Widgets.Add(SNew(SViewportWidget));
+	}
+	Results.WorldCreationMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumWidgets;
+
+	StartTime = FPlatformTime::Seconds();
+	for (const TSharedPtr<SViewportWidget>& Widget : Widgets)
+	{
+		TArray<FViewportWidgetEntry> WidgetEntries = Entries;
+		Widget->SetEntries(WidgetEntries);
+	}
+	Results.SpawnMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumWidgets;
+
+	StartTime = FPlatformTime::Seconds();
+	for (const TSharedPtr<SViewportWidget>& Widget : Widgets)
+	{
+		TArray<FViewportWidgetEntry> WidgetEntries = Entries;
+		Widget->SetEntries(WidgetEntries);
+	}
+	Results.DiffMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumWidgets;
+
+	FOffscreenDrawer Drawer;
+
+	// Render targets and PSOs of the first draw are not part of the steady state
+	Drawer.Draw(Widgets, Settings.DeltaTime);
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 TickIndex = 0; TickIndex < NumTicks; ++TickIndex)
+	{
+		Drawer.Draw(Widgets, Settings.DeltaTime);
+	}
+	Results.TickMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumTicks;
+
+	StartTime = FPlatformTime::Seconds();
+	Widgets.Reset();
+	// Total teardown cost, not just the part done when the widgets are released
+	FCustomPreviewScene::FlushTeardownQueue();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	Results.TeardownMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumWidgets;
+
+	return Results;
+}
+
+bool FViewportWidgetPerfTest::CompareToBaseline(const FResults& Results, const FResults& Baseline, float Tolerance, TArray<FString>& OutRegressions)
+{
+	for (const ViewportWidgetPerfTest_NM::FMetric& Metric : ViewportWidgetPerfTest_NM::Metrics)
+	{
+		const double Value = Results.*Metric.Value;
+		const double BaselineValue = Baseline.*Metric.Value;
+
+		if (Value > BaselineValue * (1.0 + Tolerance) && Value - BaselineValue > ViewportWidgetPerfTest_NM::MinRegressionMs)
+		{
+			OutRegressions.Add(FString::Printf(TEXT("%s: %.3f ms, baseline %.3f ms (+%.0f%%)"),
+				Metric.Name, Value, BaselineValue, BaselineValue > 0.0 ? (Value / BaselineValue - 1.0) * 100.0 : 100.0));
+		}
+	}
+
+	return OutRegressions.Num() == 0;
+}
+
+FString FViewportWidgetPerfTest::GetDefaultBaselinePath(const FSettings& Settings)
+{
+	const FString ClassName = Settings.ActorClass.IsNull() ? TEXT("Empty") : Settings.ActorClass.GetAssetName();
+
+	TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("ViewportWidget"));
+	const FString BaselineDir = (Plugin.IsValid() ? Plugin->GetBaseDir() : FPaths::ProjectPluginsDir() / TEXT("ViewportWidget")) / TEXT("Resources") / TEXT("PerfBaselines");
+
+	// Tick times without drawing aren't comparable with ones including it
+	return BaselineDir / FString::Printf(TEXT("PerfBaseline_%s_%dx%d%s.json"), *ClassName, Settings.NumWidgets, Settings.NumEntries, GUsingNullRHI ? TEXT("_NullRHI") : TEXT(""));
+}
+
+FViewportWidgetPerfTest::FOffscreenDrawer::FOffscreenDrawer(FVector2D InDrawSize)
+	: DrawSize(InDrawSize)
+{
+}
+
+FViewportWidgetPerfTest::FOffscreenDrawer::~FOffscreenDrawer()
+{
+}
+
+void FViewportWidgetPerfTest::FOffscreenDrawer::Draw(TArrayView<const TSharedPtr<SViewportWidget>> Widgets, float DeltaTime)
+{
+	if (GUsingNullRHI)
+	{
+		// The widget renderer returns right away without a renderer, nothing would be ticked. Ticking the widgets directly
+		// still runs the world tick, entry updates and view setup, the submitted draws cost nothing on the null RHI.
+		const FGeometry Geometry = FGeometry::MakeRoot(DrawSize, FSlateLayoutTransform());
+		const FIntPoint ViewportSize = DrawSize.IntPoint();
+		const double CurrentTime = FPlatformTime::Seconds();
+
+		for (const TSharedPtr<SViewportWidget>& Widget : Widgets)
+		{
+			// Sized like SViewport would on paint, so drawing isn't skipped for an empty viewport
+			TSharedPtr<FSceneViewport> SceneViewport = Widget->GetSceneViewport();
+
+			if (SceneViewport.IsValid() && SceneViewport->GetSizeXY() != ViewportSize)
+			{
+				SceneViewport->UpdateViewportRHI(false, ViewportSize.X, ViewportSize.Y, EWindowMode::Windowed, PF_Unknown);
+			}
+
+			Widget->Tick(Geometry, CurrentTime, DeltaTime);
+		}
+
+		FlushRenderingCommands();
+		return;
+	}
+
+	if (!WidgetRenderer.IsValid())
+	{
+		WidgetRenderer = MakeUnique<FWidgetRenderer>(true);
+		RenderTarget.Reset(FWidgetRenderer::CreateTargetFor(DrawSize, TF_Default, true));
+	}
+
+	// Paint ticks the widgets with their real geometry, which sizes and draws their viewports
+	for (const TSharedPtr<SViewportWidget>& Widget : Widgets)
+	{
+		WidgetRenderer->DrawWidget(RenderTarget.Get(), Widget.ToSharedRef(), DrawSize, DeltaTime);
+	}
+
+	FlushRenderingCommands();
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static TAutoConsoleVariable<float> CVarPerfTestTolerance(
+	TEXT("ViewportWidget.PerfTestTolerance"),
+	0.2f,
+	TEXT("How much slower than the baseline a ViewportWidget.Perf metric may be before the test fails, 0.2 is 20%."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPerfTestSaveBaseline(
+	TEXT("ViewportWidget.PerfTestSaveBaseline"),
+	0,
+	TEXT("1 - ViewportWidget.Perf writes its results as the new baseline instead of comparing with it."),
+	ECVF_Default);
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FViewportWidgetPerfAutomationTest, "ViewportWidget.Perf", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+void FViewportWidgetPerfAutomationTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	OutBeautifiedNames.Add(TEXT("Mannequin"));
+	OutTestCommands.Add(FViewportWidgetPerfTest::MannequinClassPath);
+
+	OutBeautifiedNames.Add(TEXT("DynamicLight"));
+	OutTestCommands.Add(FViewportWidgetPerfTest::DynamicLightClassPath);
+}
+
+bool FViewportWidgetPerfAutomationTest::RunTest(const FString& Parameters)
+{
+	if (GUsingNullRHI)
+	{
+		AddInfo(TEXT("Running on the null RHI, widgets are ticked directly and TickMs leaves out rendering, compared with the NullRHI baseline"));
+	}
+
+	FViewportWidgetPerfTest::FSettings Settings;
+	Settings.ActorClass = TSoftClassPtr<AActor>(FSoftObjectPath(Parameters));
+
+	const FViewportWidgetPerfTest::FResults Results = FViewportWidgetPerfTest::Run(Settings);
+
+	FString ResultsString;
+	FJsonSerializer::Serialize(Results.ToJson(), TJsonWriterFactory<>::Create(&ResultsString));
+	AddInfo(ResultsString);
+
+	const FString BaselinePath = FViewportWidgetPerfTest::GetDefaultBaselinePath(Settings);
+
+	if (CVarPerfTestSaveBaseline.GetValueOnGameThread() != 0)
+	{
+		FFileHelper::SaveStringToFile(ResultsString, *BaselinePath);
+		AddInfo(FString::Printf(TEXT("Baseline saved to %s"), *BaselinePath));
+		return true;
+	}
+
+	FString BaselineString;
+	TSharedPtr<FJsonObject> BaselineJson;
+	FViewportWidgetPerfTest::FResults Baseline;
+
+	if (!FFileHelper::LoadFileToString(BaselineString, *BaselinePath)
+		|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineString), BaselineJson)
+		|| !FViewportWidgetPerfTest::FResults::FromJson(BaselineJson, Baseline))
+	{
+		AddError(FString::Printf(TEXT("No baseline at %s, run with ViewportWidget.PerfTestSaveBaseline 1 to create it"), *BaselinePath));
+		return false;
+	}
+
+	TArray<FString> Regressions;
+	FViewportWidgetPerfTest::CompareToBaseline(Results, Baseline, CVarPerfTestTolerance.GetValueOnGameThread(), Regressions);
+
+	for (const FString& Regression : Regressions)
+	{
+		AddError(FString::Printf(TEXT("Regression %s"), *Regression));
+	}
+
+	return Regressions.Num() == 0;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
+
+//------------------------------------------------------
+// UViewportWidgetBenchmarkCommandlet
+//------------------------------------------------------
+
+namespace ViewportWidgetBenchmark_NM
+{
+	/**
+	 * Malloc calls of the whole process, counted by the engine allocator in non-shipping builds.
+	 * Other threads aren't paused, use -trace=memory with the LLM scope of the run for per thread attribution.
+	 */
+	uint64 GetNumAllocations()
+	{
+		return (uint64)FMalloc::TotalMallocCalls + (uint64)FMalloc::TotalReallocCalls;
+	}
+
+	struct FPhase
+	{
+		FString Name;
+		TArray<double> SamplesMs;
+		uint64 NumAllocations = 0;
+
+		/** Largest growth of used physical memory over the start of a sample */
+		uint64 PeakPhysicalGrowth = 0;
+
+		double GetPercentile(double Percentile) const
+		{
+			if (SamplesMs.Num() == 0)
+			{
+				return 0.0;
+			}
+
+			TArray<double> SortedSamplesMs = SamplesMs;
+			SortedSamplesMs.Sort();
+
+			return SortedSamplesMs[FMath::Clamp(FMath::CeilToInt(Percentile * SortedSamplesMs.Num()) - 1, 0, SortedSamplesMs.Num() - 1)];
+		}
+
+		double GetMean() const
+		{
+			double SumMs = 0.0;
+			for (const double SampleMs : SamplesMs)
+			{
+				SumMs += SampleMs;
+			}
+
+			return SamplesMs.Num() > 0 ? SumMs / SamplesMs.Num() : 0.0;
+		}
+	};
+
+	struct FScenario
+	{
+		FString Name;
+		TArray<FPhase> Phases;
+
+		/** Values that aren't timings, e.g. bytes per preview world */
+		TMap<FString, double> Metrics;
+
+		FPhase& GetPhase(const TCHAR* PhaseName)
+		{
+			if (FPhase* Phase = Phases.FindByPredicate([PhaseName](const FPhase& Phase) { return Phase.Name == PhaseName; }))
+			{
+				return *Phase;
+			}
+
+			FPhase& Phase = Phases.AddDefaulted_GetRef();
+			Phase.Name = PhaseName;
+			return Phase;
+		}
+	};
+
+	/** Runs Function once as one sample of the phase */
+	template<typename FunctionType>
+	void Measure(FScenario& Scenario, const TCHAR* PhaseName, FunctionType&& Function)
+	{
+		FPhase& Phase = Scenario.GetPhase(PhaseName);
+
+		TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(PhaseName);
+
+		const FPlatformMemoryStats StartStats = FPlatformMemory::GetStats();
+		const uint64 StartAllocations = GetNumAllocations();
+		const double StartTime = FPlatformTime::Seconds();
+
+		Function();
+
+		Phase.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Phase.NumAllocations += GetNumAllocations() - StartAllocations;
+
+		// The process peak only tells the sample's high-water if the sample raised it, otherwise the larger of the
+		// used memory at start and end is the best lower bound without sampling during the phase
+		const FPlatformMemoryStats EndStats = FPlatformMemory::GetStats();
+		const uint64 HighWater = EndStats.PeakUsedPhysical > StartStats.PeakUsedPhysical ? EndStats.PeakUsedPhysical : FMath::Max(StartStats.UsedPhysical, EndStats.UsedPhysical);
+
+		Phase.PeakPhysicalGrowth = FMath::Max(Phase.PeakPhysicalGrowth, HighWater - FMath::Min<uint64>(HighWater, StartStats.UsedPhysical));
+	}
+
+	struct FContext
+	{
+		int32 NumIterations = 100;
+		float DeltaTime = 1.f / 60.f;
+
+		TSoftClassPtr<AActor> MannequinClass;
+		TSoftClassPtr<AActor> DynamicLightClass;
+
+		FViewportWidgetPerfTest::FOffscreenDrawer Drawer;
+
+		void TickWidgets(TArrayView<const TSharedPtr<SViewportWidget>> Widgets)
+		{
+			Drawer.Draw(Widgets, DeltaTime);
+		}
+	};
+
+	/** Widgets opened and closed over and over, e.g. an inventory tooltip */
+	void RunChurn(FContext& Context, FScenario& Scenario)
+	{
+		const TArray<FViewportWidgetEntry> Entries = FViewportWidgetPerfTest::MakeGridEntries(Context.MannequinClass, 10);
+
+		for (int32 Iteration = 0; Iteration < Context.NumIterations; ++Iteration)
+		{
+			TSharedPtr<SViewportWidget> Widget;
+
+			Measure(Scenario, TEXT("Open"), [&]() { Widget = SNew(SViewportWidget); });
+			Measure(Scenario, TEXT("SetEntries"), [&]() { TArray<FViewportWidgetEntry> WidgetEntries = Entries; Widget->SetEntries(WidgetEntries); });
+			Measure(Scenario, TEXT("Tick"), [&]() { Context.TickWidgets(MakeArrayView(&Widget, 1)); });
+			Measure(Scenario, TEXT("Close"), [&]() { Widget.Reset(); });
+			Measure(Scenario, TEXT("TeardownFrame"), [&]() { FCustomPreviewScene::TickTeardownQueue(); });
+
+			if ((Iteration + 1) % 10 == 0)
+			{
+				Measure(Scenario, TEXT("CollectGarbage"), [&]() { CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS); });
+			}
+		}
+	}
+
+	/** One widget swapping the previewed class, e.g. a character selection carousel */
+	void RunCarousel(FContext& Context, FScenario& Scenario)
+	{
+		TSharedPtr<SViewportWidget> Widget = SNew(SViewportWidget);
+
+		for (int32 Iteration = 0; Iteration < Context.NumIterations; ++Iteration)
+		{
+			TArray<FViewportWidgetEntry> Entries = FViewportWidgetPerfTest::MakeGridEntries(Iteration % 2 ? Context.DynamicLightClass : Context.MannequinClass, 1);
+
+			Measure(Scenario, TEXT("Swap"), [&]() { Widget->SetEntries(Entries); });
+			Measure(Scenario, TEXT("Tick"), [&]() { Context.TickWidgets(MakeArrayView(&Widget, 1)); });
+		}
+	}
+
+	/** One widget with 500 entries that all move every iteration */
+	void RunBulkTransforms(FContext& Context, FScenario& Scenario)
+	{
+		TSharedPtr<SViewportWidget> Widget = SNew(SViewportWidget);
+		TArray<FViewportWidgetEntry> Entries = FViewportWidgetPerfTest::MakeGridEntries(Context.MannequinClass, 500);
+
+		Measure(Scenario, TEXT("InitialSpawn"), [&]() { TArray<FViewportWidgetEntry> WidgetEntries = Entries; Widget->SetEntries(WidgetEntries); });
+
+		for (int32 Iteration = 0; Iteration < Context.NumIterations; ++Iteration)
+		{
+			for (FViewportWidgetEntry& Entry : Entries)
+			{
+				Entry.SpawnTransform.SetRotation(FQuat(FRotator(0.f, Iteration * 5.f, 0.f)));
+			}
+
+			Measure(Scenario, TEXT("SetEntries"), [&]() { TArray<FViewportWidgetEntry> WidgetEntries = Entries; Widget->SetEntries(WidgetEntries); });
+			Measure(Scenario, TEXT("Tick"), [&]() { Context.TickWidgets(MakeArrayView(&Widget, 1)); });
+		}
+	}
+
+	/** 30 widgets on screen at once, e.g. a shop grid */
+	void RunManyWidgets(FContext& Context, FScenario& Scenario)
+	{
+		const TArray<FViewportWidgetEntry> Entries = FViewportWidgetPerfTest::MakeGridEntries(Context.MannequinClass, 5);
+		TArray<TSharedPtr<SViewportWidget>> Widgets;
+
+		for (int32 WidgetIndex = 0; WidgetIndex < 30; ++WidgetIndex)
+		{
+			Measure(Scenario, TEXT("Open"), [&]()
+				{
+					TArray<FViewportWidgetEntry> WidgetEntries = Entries;
+					Widgets.Add(SNew(SViewportWidget).Entries(WidgetEntries));
+				});
+		}
+
+		for (int32 Iteration = 0; Iteration < Context.NumIterations; ++Iteration)
+		{
+			Measure(Scenario, TEXT("TickAll"), [&]() { Context.TickWidgets(Widgets); });
+		}
+
+		Measure(Scenario, TEXT("CloseAll"), [&]() { Widgets.Reset(); });
+
+		// Frames the deferred teardown of all 30 scenes is spread over
+		while (FCustomPreviewScene::GetNumQueuedTeardowns() > 0)
+		{
+			Measure(Scenario, TEXT("TeardownFrame"), [&]() { FCustomPreviewScene::TickTeardownQueue(); });
+		}
+
+		Measure(Scenario, TEXT("CollectGarbage"), [&]() { CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS); });
+	}
+
+	/** Garbage collection with 20 widgets of 25 entries alive, without and with GC clusters */
+	void RunGarbageCollection(FContext& Context, FScenario& Scenario)
+	{
+		const TArray<FViewportWidgetEntry> Entries = FViewportWidgetPerfTest::MakeGridEntries(Context.MannequinClass, 25);
+		IConsoleVariable* CVarCreateGCClusters = IConsoleManager::Get().FindConsoleVariable(TEXT("ViewportWidget.CreateGCClusters"));
+		const int32 PreviousCreateGCClusters = CVarCreateGCClusters->GetInt();
+
+		for (const bool bClustered : { false, true })
+		{
+			CVarCreateGCClusters->Set(bClustered ? 1 : 0, ECVF_SetByCode);
+
+			TArray<TSharedPtr<SViewportWidget>> Widgets;
+
+			for (int32 WidgetIndex = 0; WidgetIndex < 20; ++WidgetIndex)
+			{
+				TArray<FViewportWidgetEntry> WidgetEntries = Entries;
+				Widgets.Add(SNew(SViewportWidget).Entries(WidgetEntries));
+			}
+
+			Context.TickWidgets(Widgets);
+
+			for (int32 Iteration = 0; Iteration < FMath::Max(Context.NumIterations / 10, 1); ++Iteration)
+			{
+				Measure(Scenario, bClustered ? TEXT("CollectGarbageClustered") : TEXT("CollectGarbageUnclustered"), [&]() { CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS); });
+			}
+
+			Widgets.Reset();
+			FCustomPreviewScene::FlushTeardownQueue();
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		}
+
+		CVarCreateGCClusters->Set(PreviousCreateGCClusters, ECVF_SetByCode);
+	}
+
+	/** Creating and destroying preview worlds with the default and the minimal profile, e.g. a grid of item previews */
+	void RunWorldCreation(FContext& Context, FScenario& Scenario)
+	{
+		const TPair<const TCHAR*, FCustomPreviewScene::ConstructionValues> Profiles[] =
+		{
+			{ TEXT("Default"), FCustomPreviewScene::ConstructionValues().SetForceMipsResident(false) },
+			{ TEXT("Minimal"), FCustomPreviewScene::ConstructionValues::Minimal() },
+		};
+
+		for (const TPair<const TCHAR*, FCustomPreviewScene::ConstructionValues>& Profile : Profiles)
+		{
+			FViewportWidgetMemoryUsage MemoryUsage;
+			int32 NumWorldSubsystems = 0;
+
+			for (int32 Iteration = 0; Iteration < Context.NumIterations; ++Iteration)
+			{
+				TUniquePtr<FCustomPreviewScene> PreviewScene;
+
+				Measure(Scenario, *FString::Printf(TEXT("Create%s"), Profile.Key), [&]() { PreviewScene = MakeUnique<FCustomPreviewScene>(Profile.Value); });
+
+				if (Iteration == 0)
+				{
+					MemoryUsage = PreviewScene->GetMemoryUsage();
+					NumWorldSubsystems = PreviewScene->GetNumWorldSubsystems();
+				}
+
+				Measure(Scenario, *FString::Printf(TEXT("Destroy%s"), Profile.Key), [&]() { PreviewScene.Reset(); });
+
+				if ((Iteration + 1) % 10 == 0)
+				{
+					CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+				}
+			}
+
+			Scenario.Metrics.Add(FString::Printf(TEXT("%sBytesPerWorld"), Profile.Key), MemoryUsage.GetTotalBytes());
+			Scenario.Metrics.Add(FString::Printf(TEXT("%sObjectsPerWorld"), Profile.Key), MemoryUsage.NumObjects);
+			Scenario.Metrics.Add(FString::Printf(TEXT("%sWorldSubsystems"), Profile.Key), NumWorldSubsystems);
+		}
+	}
+}
+
+UViewportWidgetBenchmarkCommandlet::UViewportWidgetBenchmarkCommandlet()
+{
+	LogToConsole = true;
+}
+
+int32 UViewportWidgetBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace ViewportWidgetBenchmark_NM;
+
+	FString ScenarioName = TEXT("All");
+	FParse::Value(*Params, TEXT("Scenario="), ScenarioName);
+
+	FContext Context;
+	FParse::Value(*Params, TEXT("Iterations="), Context.NumIterations);
+	FParse::Value(*Params, TEXT("DeltaTime="), Context.DeltaTime);
+	Context.MannequinClass = TSoftClassPtr<AActor>(FSoftObjectPath(FViewportWidgetPerfTest::MannequinClassPath));
+	Context.DynamicLightClass = TSoftClassPtr<AActor>(FSoftObjectPath(FViewportWidgetPerfTest::DynamicLightClassPath));
+
+	FString OutputDir = FPaths::ProjectSavedDir() / TEXT("ViewportWidget") / TEXT("Benchmark");
+	FParse::Value(*Params, TEXT("Output="), OutputDir);
+
+	// Class loading is not part of any measured phase
+	Context.MannequinClass.LoadSynchronous();
+	Context.DynamicLightClass.LoadSynchronous();
+
+	// Viewport widgets only need the application object, not a renderer. Commandlets run on the null RHI unless
+	// -AllowCommandletRendering is passed, the drawer ticks the widgets directly then
+	const bool bCreatedSlateApplication = !FSlateApplication::IsInitialized();
+	if (bCreatedSlateApplication)
+	{
+		FSlateApplication::Create();
+	}
+
+	typedef void (*FScenarioFunction)(FContext&, FScenario&);
+	const TPair<const TCHAR*, FScenarioFunction> ScenarioFunctions[] =
+	{
+		{ TEXT("Churn"), &RunChurn },
+		{ TEXT("Carousel"), &RunCarousel },
+		{ TEXT("BulkTransforms"), &RunBulkTransforms },
+		{ TEXT("ManyWidgets"), &RunManyWidgets },
+		{ TEXT("GarbageCollection"), &RunGarbageCollection },
+		{ TEXT("WorldCreation"), &RunWorldCreation },
+	};
+
+	TArray<FScenario> Scenarios;
+
+	LLM_SCOPE_BYNAME(TEXT("ViewportWidgetBenchmark"));
+
+	for (const TPair<const TCHAR*, FScenarioFunction>& ScenarioFunction : ScenarioFunctions)
+	{
+		if (ScenarioName == TEXT("All") || ScenarioName == ScenarioFunction.Key)
+		{
+			UE_LOG(LogViewportWidget, Display, TEXT("Running benchmark scenario %s"), ScenarioFunction.Key);
+
+			FScenario& Scenario = Scenarios.AddDefaulted_GetRef();
+			Scenario.Name = ScenarioFunction.Key;
+			ScenarioFunction.Value(Context, Scenario);
+
+			FCustomPreviewScene::FlushTeardownQueue();
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		}
+	}
+
+	if (bCreatedSlateApplication)
+	{
+		FSlateApplication::Shutdown();
+	}
+
+	if (Scenarios.Num() == 0)
+	{
+		UE_LOG(LogViewportWidget, Error, TEXT("Unknown benchmark scenario %s"), *ScenarioName);
+		return 1;
+	}
+
+	TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("ViewportWidget"));
+	const FString PluginVersion = Plugin.IsValid() ? Plugin->GetDescriptor().VersionName : TEXT("Unknown");
+
+	FString Csv = TEXT("Scenario,Phase,Samples,MeanMs,P50Ms,P95Ms,P99Ms,MaxMs,AllocationsPerSample,PeakPhysicalGrowthMB\n");
+
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetStringField(TEXT("PluginVersion"), PluginVersion);
+	Json->SetNumberField(TEXT("Iterations"), Context.NumIterations);
+	Json->SetNumberField(TEXT("DeltaTime"), Context.DeltaTime);
+
+	TArray<TSharedPtr<FJsonValue>> ScenarioValues;
+
+	for (const FScenario& Scenario : Scenarios)
+	{
+		TArray<TSharedPtr<FJsonValue>> PhaseValues;
+
+		for (const FPhase& Phase : Scenario.Phases)
+		{
+			const double AllocationsPerSample = Phase.SamplesMs.Num() > 0 ? (double)Phase.NumAllocations / Phase.SamplesMs.Num() : 0.0;
+			const double PeakPhysicalGrowthMB = Phase.PeakPhysicalGrowth / (1024.0 * 1024.0);
+			const double MaxMs = Phase.GetPercentile(1.0);
+
+			Csv += FString::Printf(TEXT("%s,%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.1f,%.1f\n"),
+				*Scenario.Name, *Phase.Name, Phase.SamplesMs.Num(), Phase.GetMean(), Phase.GetPercentile(0.5), Phase.GetPercentile(0.95), Phase.GetPercentile(0.99), MaxMs, AllocationsPerSample, PeakPhysicalGrowthMB);
+
+			TSharedRef<FJsonObject> PhaseJson = MakeShared<FJsonObject>();
+			PhaseJson->SetStringField(TEXT("Name"), Phase.Name);
+			PhaseJson->SetNumberField(TEXT("Samples"), Phase.SamplesMs.Num());
+			PhaseJson->SetNumberField(TEXT("MeanMs"), Phase.GetMean());
+			PhaseJson->SetNumberField(TEXT("P50Ms"), Phase.GetPercentile(0.5));
+			PhaseJson->SetNumberField(TEXT("P95Ms"), Phase.GetPercentile(0.95));
+			PhaseJson->SetNumberField(TEXT("P99Ms"), Phase.GetPercentile(0.99));
+			PhaseJson->SetNumberField(TEXT("MaxMs"), MaxMs);
+			PhaseJson->SetNumberField(TEXT("AllocationsPerSample"), AllocationsPerSample);
+			PhaseJson->SetNumberField(TEXT("PeakPhysicalGrowthMB"), PeakPhysicalGrowthMB);
+			PhaseValues.Add(MakeShared<FJsonValueObject>(PhaseJson));
+
+			UE_LOG(LogViewportWidget, Display, TEXT("%s/%s: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, %.1f allocations"),
+				*Scenario.Name, *Phase.Name, Phase.GetPercentile(0.5), Phase.GetPercentile(0.95), Phase.GetPercentile(0.99), AllocationsPerSample);
+		}
+
+		TSharedRef<FJsonObject> ScenarioJson = MakeShared<FJsonObject>();
+		ScenarioJson->SetStringField(TEXT("Name"), Scenario.Name);
+		ScenarioJson->SetArrayField(TEXT("Phases"), PhaseValues);
+
+		if (Scenario.Metrics.Num() > 0)
+		{
+			TSharedRef<FJsonObject> MetricsJson = MakeShared<FJsonObject>();
+
+			for (const TPair<FString, double>& Metric : Scenario.Metrics)
+			{
+				MetricsJson->SetNumberField(Metric.Key, Metric.Value);
+
+				UE_LOG(LogViewportWidget, Display, TEXT("%s/%s: %.0f"), *Scenario.Name, *Metric.Key, Metric.Value);
+			}
+
+			ScenarioJson->SetObjectField(TEXT("Metrics"), MetricsJson);
+		}
+		ScenarioValues.Add(MakeShared<FJsonValueObject>(ScenarioJson));
+	}
+
+	Json->SetArrayField(TEXT("Scenarios"), ScenarioValues);
+
+	FString JsonString;
+	FJsonSerializer::Serialize(Json, TJsonWriterFactory<>::Create(&JsonString));
+
+	const FString BaseFileName = OutputDir / FString::Printf(TEXT("ViewportWidgetBenchmark_%s_%s"), *PluginVersion, *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(Csv, *(BaseFileName + TEXT(".csv")));
+	FFileHelper::SaveStringToFile(JsonString, *(BaseFileName + TEXT(".json")));
+
+	UE_LOG(LogViewportWidget, Display, TEXT("Benchmark results written to %s.csv/.json"), *BaseFileName);
+
+	return 0;
+}
@@ -0,0 +1,33 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "ViewportWidgetBenchmarkCommandlet.generated.h"
+
+//------------------------------------------------------
+// UViewportWidgetBenchmarkCommandlet
+//------------------------------------------------------
+
+/**
+ * Runs scripted viewport widget scenarios with a fixed delta time and writes per phase percentiles, allocation counts
+ * and the peak growth of used physical memory within a sample to CSV and JSON, plus scenario metrics such as bytes per preview world to JSON,
+ * so results can be compared across plugin versions.
+ * Runs headless: without a renderer the widgets are ticked directly, world ticks and view setup are measured but not rendering.
+ * With -AllowCommandletRendering they are drawn off-screen at a fixed size and draw costs are included.
+ *
+ * Usage: -run=ViewportWidgetBenchmark [-Scenario=All|Churn|Carousel|BulkTransforms|ManyWidgets|GarbageCollection|WorldCreation]
+ *        [-Iterations=100] [-DeltaTime=0.016667] [-Output=<directory>]
+ */
+UCLASS()
+class VIEWPORTWIDGETDEVELOPER_API UViewportWidgetBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UViewportWidgetBenchmarkCommandlet();
+
+	//~ UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End of UCommandlet interface
+};
@@ -0,0 +1,98 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "ViewportWidgetEntry.h"
+#include "UObject/StrongObjectPtr.h"
+
+class FJsonObject;
+class SViewportWidget;
+class FWidgetRenderer;
+class UTextureRenderTarget2D;
+
+//------------------------------------------------------
+// FViewportWidgetPerfTest
+//------------------------------------------------------
+
+/**
+ * Measures the cost of viewport widgets drawn off-screen, run by the ViewportWidget.Perf automation test.
+ * Results are compared with the baseline saved in the plugin's Resources folder, a metric slower than the baseline by more than the tolerance
+ * fails the test, as does a missing baseline. Baselines are saved with ViewportWidget.PerfTestSaveBaseline 1 on the reference machine,
+ * separately for runs with -nullrhi where the widgets are ticked without rendering.
+ */
+class VIEWPORTWIDGETDEVELOPER_API FViewportWidgetPerfTest
+{
+public:
+	struct FSettings
+	{
+		int32 NumWidgets = 10;
+		int32 NumEntries = 10;
+		int32 NumTicks = 60;
+
+		/** Fixed delta time the widgets are ticked with, for reproducible results */
+		float DeltaTime = 1.f / 60.f;
+
+		TSoftClassPtr<AActor> ActorClass;
+	};
+
+	struct FResults
+	{
+		/** Constructing a widget with its preview world, per widget */
+		double WorldCreationMs = 0.0;
+
+		/** SetEntries spawning all entries, per widget */
+		double SpawnMs = 0.0;
+
+		/** SetEntries with unchanged entries, per widget */
+		double DiffMs = 0.0;
+
+		/** Ticking and drawing all widgets once, ticking only with -nullrhi */
+		double TickMs = 0.0;
+
+		/** Destroying a widget and collecting its preview world, per widget */
+		double TeardownMs = 0.0;
+
+		TSharedRef<FJsonObject> ToJson() const;
+
+		static bool FromJson(const TSharedPtr<FJsonObject>& Json, FResults& OutResults);
+	};
+
+	static FResults Run(const FSettings& Settings);
+
+	/**
+	 * @return False if any metric exceeds the baseline by more than Tolerance (0.2 is 20%)
+	 *
+	 * @param OutRegressions	Description of every regressed metric
+	 */
+	static bool CompareToBaseline(const FResults& Results, const FResults& Baseline, float Tolerance, TArray<FString>& OutRegressions);
+
+	/** @return Baseline file of the settings in the plugin's Resources folder, NullRHI runs have their own */
+	static FString GetDefaultBaselinePath(const FSettings& Settings);
+
+	/**
+	 * Ticks and paints widgets off-screen at a fixed size, so their viewports are sized and drawn like on screen.
+	 * Without a renderer (-nullrhi) the widgets are sized and ticked directly, as nothing would be painted.
+	 */
+	class FOffscreenDrawer
+	{
+	public:
+		FOffscreenDrawer(FVector2D InDrawSize = FVector2D(256.f, 256.f));
+		~FOffscreenDrawer();
+
+		/** Draws every widget once and waits for the rendering thread, so the frame is part of the measurement */
+		void Draw(TArrayView<const TSharedPtr<SViewportWidget>> Widgets, float DeltaTime);
+
+	private:
+		FVector2D DrawSize;
+
+		TUniquePtr<FWidgetRenderer> WidgetRenderer;
+		TStrongObjectPtr<UTextureRenderTarget2D> RenderTarget;
+	};
+
+	/** @return Entries of the given class laid out on a grid */
+	static TArray<FViewportWidgetEntry> MakeGridEntries(const TSoftClassPtr<AActor>& ActorClass, int32 NumEntries);
+
+	/** Demo content used as realistic workloads */
+	static const TCHAR* MannequinClassPath;
+	static const TCHAR* DynamicLightClassPath;
+};
@@ -0,0 +1,37 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+using UnrealBuildTool;
+
+public class ViewportWidgetDeveloper : ModuleRules
+{
+	public ViewportWidgetDeveloper(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+                "Core",
+                "CoreUObject",
+                "Engine",
+				// ... add other public dependencies that you statically link with here ...
+			}
+			);
+			
+		
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+                "ViewportWidget",
+                "SlateCore",
+                "Slate",
+                "UMG",
+                "RenderCore",
+                "RHI",
+                "Json",
+                "Projects",
+				// ... add private dependencies that you statically link with here ...	
+			}
+			);
+	}
+}